@@ -32,6 +32,7 @@
 #include "actions.h"
 #include "charset.h"
 #include "config.h"
+#include "database.h"
 #include "display.h"
 #include "global.h"
 #include "mpdpp.h"
@@ -99,6 +100,16 @@ bool findSelectedRangeAndPrintInfoIfNot(Iterator &first, Iterator &last)
 	return success;
 }
 
+/// Actions operating on the whole main playlist can't be run
+/// while it's being fetched in parts as only some songs are there.
+bool playlistLoadedAndPrintInfoIfNot()
+{
+	bool loaded = !Status::State::playlistLoading();
+	if (!loaded)
+		Statusbar::print("Playlist is still being loaded");
+	return loaded;
+}
+
 }
 
 namespace Actions {
@@ -925,14 +936,13 @@ void MoveSelectedItemsTo::run()
 	if (myScreen == myPlaylist)
 	{
 		if (!myPlaylist->main().empty())
-			moveSelectedItemsTo(myPlaylist->main(), std::bind(&MPD::Connection::Move, ph::_1, ph::_2, ph::_3));
+			moveSelectedItemsTo(myPlaylist->main(), std::bind(permutePlaylist, 0, ph::_1));
 	}
 	else
 	{
 		assert(!myPlaylistEditor->Playlists.empty());
 		std::string playlist = myPlaylistEditor->Playlists.current()->value().path();
-		auto move_fun = std::bind(&MPD::Connection::PlaylistMove, ph::_1, playlist, ph::_2, ph::_3);
-		moveSelectedItemsTo(myPlaylistEditor->Content, move_fun);
+		moveSelectedItemsTo(myPlaylistEditor->Content, std::bind(permuteStoredPlaylist, playlist, ph::_1));
 	}
 }
 
@@ -1047,6 +1057,7 @@ void ToggleDisplayMode::run()
 				myBrowser->main().setTitle("");
 				break;
 		}
+		myBrowser->main().invalidate();
 		Statusbar::printf("Browser display mode: %1%", Config.browser_display_mode);
 	}
 	else if (myScreen == mySearcher)
@@ -1060,6 +1071,7 @@ void ToggleDisplayMode::run()
 				Config.search_engine_display_mode = DisplayMode::Classic;
 				break;
 		}
+		mySearcher->main().invalidate();
 		Statusbar::printf("Search engine display mode: %1%", Config.search_engine_display_mode);
 		if (mySearcher->main().size() > SearchEngine::StaticOptions)
 			mySearcher->main().setTitle(
@@ -1098,6 +1110,7 @@ bool ToggleSeparatorsBetweenAlbums::canBeRun()
 void ToggleSeparatorsBetweenAlbums::run()
 {
 	Config.playlist_separate_albums = !Config.playlist_separate_albums;
+	NC::List::invalidateAll();
 	Statusbar::printf("Separators between albums: %1%",
 		Config.playlist_separate_albums ? "on" : "off"
 	);
@@ -1842,6 +1855,11 @@ void AddSelectedItems::run()
 	mySelectedItemsAdder->switchTo();
 }
 
+bool CropMainPlaylist::canBeRun()
+{
+	return playlistLoadedAndPrintInfoIfNot();
+}
+
 void CropMainPlaylist::run()
 {
 	auto &w = myPlaylist->main();
@@ -1907,7 +1925,9 @@ bool SortPlaylist::canBeRun()
 	if (myScreen != myPlaylist)
 		return false;
 	auto first = myPlaylist->main().begin(), last = myPlaylist->main().end();
-	return findSelectedRangeAndPrintInfoIfNot(first, last);
+	if (!findSelectedRangeAndPrintInfoIfNot(first, last))
+		return false;
+	return hasSelected(first, last) || playlistLoadedAndPrintInfoIfNot();
 }
 
 void SortPlaylist::run()
@@ -1921,16 +1941,18 @@ bool ReversePlaylist::canBeRun()
 		return false;
 	m_begin = myPlaylist->main().begin();
 	m_end = myPlaylist->main().end();
-	return findSelectedRangeAndPrintInfoIfNot(m_begin, m_end);
+	if (!findSelectedRangeAndPrintInfoIfNot(m_begin, m_end))
+		return false;
+	return hasSelected(m_begin, m_end) || playlistLoadedAndPrintInfoIfNot();
 }
 
 void ReversePlaylist::run()
 {
 	Statusbar::print("Reversing range...");
-	Mpd.StartCommandsList();
-	for (--m_end; m_begin < m_end; ++m_begin, --m_end)
-		Mpd.Swap(m_begin->value().getPosition(), m_end->value().getPosition());
-	Mpd.CommitCommandsList();
+	std::vector<size_t> permutation(m_end-m_begin);
+	for (size_t i = 0; i < permutation.size(); ++i)
+		permutation[i] = permutation.size()-i-1;
+	permutePlaylist(m_begin->value().getPosition(), permutation);
 	Statusbar::print("Range reversed");
 }
 
@@ -2124,7 +2146,7 @@ void AddRandomItems::run()
 		Statusbar::put() << "Number of random " << tag_type_str << "s: ";
 		number = fromString<unsigned>(wFooter->prompt());
 	}
-	if (number && (rnd_type == 's' ? Mpd.AddRandomSongs(number) : Mpd.AddRandomTag(tag_type, number)))
+	if (number && (rnd_type == 's' ? Mpd.AddRandomSongs(number, Database::songs()) : Mpd.AddRandomTag(tag_type, number)))
 	{
 		Statusbar::printf("%1% random %2%%3% added to playlist",
 			number, tag_type_str, number == 1 ? "" : "s"
@@ -2160,8 +2182,8 @@ void ToggleBrowserSortMode::run()
 	if (Config.browser_sort_mode != SortMode::NoOp)
 	{
 		size_t sort_offset = myBrowser->inRootDirectory() ? 0 : 1;
-		std::sort(myBrowser->main().begin()+sort_offset, myBrowser->main().end(),
-			LocaleBasedItemSorting(std::locale(), Config.ignore_leading_the, Config.browser_sort_mode)
+		LocaleBasedItemSorting(std::locale(), Config.ignore_leading_the, Config.browser_sort_mode).sort(
+			myBrowser->main().begin()+sort_offset, myBrowser->main().end()
 		);
 	}
 }
@@ -2919,6 +2941,7 @@ void findItem(const SearchDirection direction)
 	std::string constraint;
 	{
 		Statusbar::ScopedLock slock;
+		IncrementalSearch incremental_search;
 		NC::Window::ScopedPromptHook prompt_hook(*wFooter,
 			Statusbar::Helpers::FindImmediately(w, direction)
 		);
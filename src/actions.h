@@ -888,6 +888,7 @@ struct CropMainPlaylist: BaseAction
 	CropMainPlaylist(): BaseAction(Type::CropMainPlaylist, "crop_main_playlist") { }
 	
 private:
+	virtual bool canBeRun() OVERRIDE;
 	virtual void run() OVERRIDE;
 };
 
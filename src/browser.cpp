@@ -23,6 +23,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/locale/conversion.hpp>
 #include <time.h>
+#include <unordered_map>
 
 #include "browser.h"
 #include "charset.h"
@@ -56,6 +57,26 @@ namespace {
 
 std::set<std::string> lm_supported_extensions;
 
+// Sort keys of songs in a directory, valid as long as modification
+// time of the directory (and of a particular song) doesn't change.
+struct SortKeys
+{
+	SortKeys() : mtime(0) { }
+
+	time_t mtime;
+	// uri -> (modification time of the song, its sort key)
+	std::unordered_map<std::string, std::pair<time_t, std::string>> keys;
+};
+
+// maximum number of directories keys are kept for
+const size_t sort_keys_cache_limit = 256;
+
+std::unordered_map<std::string, SortKeys> browser_sort_keys;
+std::unordered_map<std::string, SortKeys> recursive_sort_keys;
+
+// modification times of mpd directories seen in listings
+std::unordered_map<std::string, time_t> mpd_directory_mtimes;
+
 std::string realPath(bool local_browser, std::string path);
 bool isStringParentDirectory(const std::string &directory);
 bool isItemParentDirectory(const MPD::Item &item);
@@ -70,6 +91,57 @@ void clearDirectory(const std::string &directory);
 std::string itemToString(const MPD::Item &item);
 bool browserEntryMatcher(const Regex::Regex &rx, const MPD::Item &item, bool filter);
 
+const MPD::Song *songOf(const MPD::Item &item)
+{
+	return item.type() == MPD::Item::Type::Song ? &item.song() : nullptr;
+}
+
+const MPD::Song *songOf(const MPD::Song &s)
+{
+	return &s;
+}
+
+/// Sorts the range by keys returned by key function, reusing keys of songs
+/// cached for the directory the range comes from (and replacing them with
+/// keys of the songs in the range).
+template <typename Iterator, typename KeyFunction>
+void sortWithCachedKeys(Iterator first, Iterator last,
+                        std::unordered_map<std::string, SortKeys> &cache,
+                        const std::string &directory, time_t mtime,
+                        KeyFunction key)
+{
+	typedef typename std::iterator_traits<Iterator>::value_type ValueT;
+
+	if (cache.size() >= sort_keys_cache_limit && cache.count(directory) == 0)
+		cache.clear();
+	auto &sort_keys = cache[directory];
+	if (sort_keys.mtime != mtime)
+	{
+		sort_keys.mtime = mtime;
+		sort_keys.keys.clear();
+	}
+
+	auto keys = computeKeys(first, last, [&sort_keys, &key](const ValueT &v) -> std::string {
+		auto s = songOf(v);
+		if (s != nullptr)
+		{
+			auto it = sort_keys.keys.find(s->getURI());
+			if (it != sort_keys.keys.end() && it->second.first == s->getMTime())
+				return it->second.second;
+		}
+		return key(v);
+	});
+
+	sort_keys.keys.clear();
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		auto s = songOf(*(first+i));
+		if (s != nullptr)
+			sort_keys.keys[s->getURI()] = std::make_pair(s->getMTime(), keys[i]);
+	}
+	sortByKeys(first, last, std::move(keys));
+}
+
 template <bool Const>
 struct SongExtractor
 {
@@ -445,8 +517,12 @@ void Browser::getDirectory(std::string directory)
 		directory = "/";
 
 	std::vector<MPD::Item> items;
+	time_t mtime;
 	if (m_local_browser)
+	{
 		getLocalDirectory(items, directory);
+		mtime = fs::last_write_time(directory);
+	}
 	else
 	{
 		std::copy(
@@ -454,13 +530,28 @@ void Browser::getDirectory(std::string directory)
 			std::make_move_iterator(MPD::ItemIterator()),
 			std::back_inserter(items)
 		);
+		for (const auto &item : items)
+			if (item.type() == MPD::Item::Type::Directory)
+				mpd_directory_mtimes[item.directory().path()] = item.directory().lastModified();
+		// we only know it if we've seen the parent directory, but if we didn't,
+		// changed songs are still detected by their modification times.
+		auto it = mpd_directory_mtimes.find(directory);
+		mtime = it != mpd_directory_mtimes.end() ? it->second : 0;
 	}
 
 	// sort items
-	if (Config.browser_sort_mode != SortMode::NoOp)
+	if (Config.browser_sort_mode == SortMode::CustomFormat)
+	{
+		// formatting songs is expensive, so reuse the keys if possible
+		LocaleBasedItemSorting cmp(std::locale(), Config.ignore_leading_the, Config.browser_sort_mode);
+		sortWithCachedKeys(items.begin(), items.end(), browser_sort_keys, directory, mtime,
+			[&cmp](const MPD::Item &item) { return cmp.key(item); }
+		);
+	}
+	else if (Config.browser_sort_mode != SortMode::NoOp)
 	{
-		std::sort(items.begin(), items.end(),
-			LocaleBasedItemSorting(std::locale(), Config.ignore_leading_the, Config.browser_sort_mode)
+		LocaleBasedItemSorting(std::locale(), Config.ignore_leading_the, Config.browser_sort_mode).sort(
+			items.begin(), items.end()
 		);
 	}
 
@@ -490,14 +581,12 @@ void Browser::getDirectory(std::string directory)
 			}
 			case MPD::Item::Type::Song:
 			{
-				auto properties = NC::List::Properties::Selectable;
-				if (myPlaylist->checkForSong(item.song()))
-					properties |= NC::List::Properties::Bold;
-				w.addItem(std::move(item), properties);
+				w.addItem(std::move(item));
 				break;
 			}
 		}
 	}
+	markSongsInPlaylist(w);
 	m_current_directory = directory;
 }
 
@@ -665,10 +754,13 @@ void getLocalDirectoryRecursively(std::vector<MPD::Song> &songs, const std::stri
 			songs.push_back(getLocalSong(*entry, false));
 	};
 
+	// tags are not read here, so songs are always sorted by their names
 	if (Config.browser_sort_mode != SortMode::NoOp)
 	{
-		std::sort(songs.begin()+sort_offset, songs.end(),
-			LocaleBasedSorting(std::locale(), Config.ignore_leading_the)
+		LocaleBasedSorting cmp(std::locale(), Config.ignore_leading_the);
+		sortWithCachedKeys(songs.begin()+sort_offset, songs.end(), recursive_sort_keys,
+			directory, fs::last_write_time(directory),
+			[&cmp](const MPD::Song &s) { return cmp.key(s); }
 		);
 	}
 }
@@ -186,6 +186,7 @@ bool configure(int argc, char **argv)
 		if (!vm["port"].defaulted())
 			Mpd.SetPort(vm["port"].as<int>());
 		Mpd.SetTimeout(Config.mpd_connection_timeout);
+		Mpd.SetDedicatedIdleConnection(Config.mpd_dedicated_idle_connection);
 
 		// print current song
 		if (vm.count("current-song"))
@@ -0,0 +1,431 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "database.h"
+#include "helpers.h"
+#include "mpdpp.h"
+#include "settings.h"
+
+namespace {
+
+// Format of the snapshot: header consisting of lines with file version,
+// address of the server, database update time and number of songs,
+// followed by songs stored as sequences of null-terminated name-value
+// pairs (as they are sent by MPD), each one terminated by empty name.
+const char snapshot_version[] = "ncmpcpp database snapshot 3";
+
+std::vector<MPD::Song> m_songs;
+std::string m_songs_server;
+unsigned long m_songs_update_time;
+bool m_songs_verified = false;
+
+SongIndex m_index;
+// whether m_index corresponds to m_songs
+bool m_index_built = false;
+
+std::string snapshotPath()
+{
+	return Config.ncmpcpp_directory + "database";
+}
+
+std::string serverAddress()
+{
+	return Mpd.GetHostname() + ":" + boost::lexical_cast<std::string>(Mpd.GetPort());
+}
+
+struct MappedFile
+{
+	MappedFile(const std::string &path)
+	: m_data(nullptr), m_size(0)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED)
+			{
+				m_data = static_cast<const char *>(data);
+				m_size = st.st_size;
+			}
+		}
+		close(fd);
+	}
+	~MappedFile()
+	{
+		if (m_data != nullptr)
+			munmap(const_cast<char *>(m_data), m_size);
+	}
+
+	const char *data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	const char *m_data;
+	size_t m_size;
+};
+
+struct SnapshotReader
+{
+	SnapshotReader(const char *data, size_t size)
+	: m_pos(data), m_end(data+size)
+	{ }
+
+	bool readLine(std::string &line)
+	{
+		auto nl = static_cast<const char *>(memchr(m_pos, '\n', m_end-m_pos));
+		if (nl == nullptr)
+			return false;
+		line.assign(m_pos, nl);
+		m_pos = nl+1;
+		return true;
+	}
+
+	/// @return pointer to the null-terminated string inside
+	/// the mapped file or nullptr if the file is truncated.
+	const char *readString()
+	{
+		auto zero = static_cast<const char *>(memchr(m_pos, '\0', m_end-m_pos));
+		if (zero == nullptr)
+			return nullptr;
+		auto result = m_pos;
+		m_pos = zero+1;
+		return result;
+	}
+
+private:
+	const char *m_pos;
+	const char *m_end;
+};
+
+bool loadSnapshot(const std::string &server)
+{
+	MappedFile file(snapshotPath());
+	if (file.data() == nullptr)
+		return false;
+	SnapshotReader reader(file.data(), file.size());
+
+	std::string version, snapshot_server, update_time, song_count;
+	if (!reader.readLine(version)
+	||  !reader.readLine(snapshot_server)
+	||  !reader.readLine(update_time)
+	||  !reader.readLine(song_count))
+		return false;
+	if (version != snapshot_version || snapshot_server != server)
+		return false;
+
+	std::vector<MPD::Song> songs;
+	unsigned long snapshot_update_time;
+	size_t songs_left;
+	try
+	{
+		snapshot_update_time = boost::lexical_cast<unsigned long>(update_time);
+		songs_left = boost::lexical_cast<size_t>(song_count);
+	}
+	catch (boost::bad_lexical_cast &)
+	{
+		return false;
+	}
+	// each song takes more than one byte, so the snapshot
+	// is corrupted if it claims to contain more of them.
+	if (songs_left > file.size())
+		return false;
+	songs.reserve(songs_left);
+	for (; songs_left > 0; --songs_left)
+	{
+		mpd_pair pair;
+		pair.name = reader.readString();
+		pair.value = reader.readString();
+		if (pair.name == nullptr || pair.value == nullptr)
+			return false;
+		mpd_song *s = mpd_song_begin(&pair);
+		if (s == nullptr)
+			return false;
+		songs.push_back(MPD::Song(s));
+		while ((pair.name = reader.readString()) != nullptr && *pair.name != '\0')
+		{
+			if ((pair.value = reader.readString()) == nullptr)
+				return false;
+			mpd_song_feed(s, &pair);
+		}
+		if (pair.name == nullptr)
+			return false;
+		songs.back() = MPD::Song::intern(std::move(songs.back()));
+	}
+	m_songs = std::move(songs);
+	m_songs_update_time = snapshot_update_time;
+	m_index_built = false;
+	return true;
+}
+
+void writePair(std::ostream &f, const char *name, const char *value)
+{
+	f.write(name, strlen(name)+1);
+	f.write(value, strlen(value)+1);
+}
+
+void writeSong(std::ostream &f, const MPD::Song &s)
+{
+	writePair(f, "file", s.c_uri());
+	for (int type = 0; type < MPD_TAG_COUNT; ++type)
+	{
+		auto tag_type = static_cast<mpd_tag_type>(type);
+		std::string tag;
+		for (unsigned idx = 0; !(tag = s.get(tag_type, idx)).empty(); ++idx)
+			writePair(f, mpd_tag_name(tag_type), tag.c_str());
+	}
+	if (s.getDuration() > 0)
+		writePair(f, "Time", boost::lexical_cast<std::string>(s.getDuration()).c_str());
+	time_t mtime = s.getMTime();
+	if (mtime > 0)
+	{
+		char buf[32];
+		tm tinfo;
+		gmtime_r(&mtime, &tinfo);
+		strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tinfo);
+		writePair(f, "Last-Modified", buf);
+	}
+	f.put('\0');
+}
+
+void saveSnapshot()
+{
+	// write to temporary file first so that a snapshot that is being
+	// written is never read by accident. Its name needs to be unique as
+	// other instances connected to the same server may write it as well.
+	std::string path = snapshotPath();
+	std::string tmp_path = path + ".XXXXXX";
+	int fd = mkstemp(&tmp_path[0]);
+	if (fd < 0)
+		return;
+	close(fd);
+	{
+		std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!f.is_open())
+		{
+			std::remove(tmp_path.c_str());
+			return;
+		}
+		f << snapshot_version << '\n'
+		  << m_songs_server << '\n'
+		  << m_songs_update_time << '\n'
+		  << m_songs.size() << '\n';
+		for (const auto &s : m_songs)
+			writeSong(f, s);
+		if (!f.good())
+		{
+			f.close();
+			std::remove(tmp_path.c_str());
+			return;
+		}
+	}
+	if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+		std::remove(tmp_path.c_str());
+}
+
+/// @return directory the song with given uri belongs to,
+/// empty string if it's located in the root directory.
+std::string parentDirectory(const char *uri)
+{
+	const char *slash = strrchr(uri, '/');
+	if (slash != nullptr)
+		return std::string(uri, slash);
+	else
+		return "";
+}
+
+bool fetchDatabase(size_t expected_songs)
+{
+	m_songs.clear();
+	m_songs.reserve(expected_songs);
+	m_index_built = false;
+	for (MPD::ItemIterator item = getDatabaseIterator(Mpd), end; item != end; ++item)
+		if (item->type() == MPD::Item::Type::Song)
+			m_songs.push_back(item->song());
+	// if the database couldn't be fetched as a whole,
+	// don't keep it and try again next time.
+	return m_songs.size() == expected_songs;
+}
+
+/// Brings cached songs up to date with the database. Uris of all songs are
+/// listed first (which is cheap as it's done without their metadata) and
+/// compared with the cached ones, so that songs that are gone are dropped
+/// and the new ones are looked up. Songs modified since the last update
+/// are requested separately as their uris stay the same.
+bool syncDatabase(size_t expected_songs)
+{
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 10, 0)
+	try
+	{
+		std::vector<std::string> uris;
+		uris.reserve(expected_songs);
+		for (MPD::StringIterator uri = Mpd.GetDirectoryRecursiveUris("/"), end; uri != end; ++uri)
+			uris.push_back(std::move(*uri));
+		std::sort(uris.begin(), uris.end());
+
+		std::vector<MPD::Song> fetched;
+		std::set<std::string> modified_uris;
+		Mpd.StartSearch(true);
+		Mpd.AddSearchModifiedSince(m_songs_update_time);
+		for (MPD::SongIterator s = Mpd.CommitSearchSongs(), end; s != end; ++s)
+		{
+			modified_uris.insert(s->getURI());
+			fetched.push_back(std::move(*s));
+		}
+
+		std::vector<bool> outdated(m_songs.size());
+		std::vector<std::string> kept_uris;
+		kept_uris.reserve(m_songs.size());
+		for (size_t i = 0; i < m_songs.size(); ++i)
+		{
+			std::string uri = m_songs[i].getURI();
+			outdated[i] = !std::binary_search(uris.begin(), uris.end(), uri)
+			           || modified_uris.count(uri) > 0;
+			if (!outdated[i])
+				kept_uris.push_back(std::move(uri));
+		}
+		std::sort(kept_uris.begin(), kept_uris.end());
+
+		// songs that are neither cached nor modified, e.g. moved or renamed
+		// ones, are fetched by listing directories they are located in.
+		std::set<std::string> new_uris, new_directories;
+		for (auto &uri : uris)
+		{
+			if (!std::binary_search(kept_uris.begin(), kept_uris.end(), uri)
+			&&  modified_uris.count(uri) == 0)
+			{
+				new_directories.insert(parentDirectory(uri.c_str()));
+				new_uris.insert(std::move(uri));
+			}
+		}
+		for (const auto &dir : new_directories)
+		{
+			for (MPD::SongIterator s = Mpd.GetSongs(dir.empty() ? "/" : dir), end; s != end; ++s)
+				if (new_uris.count(s->getURI()) > 0)
+					fetched.push_back(std::move(*s));
+		}
+
+		size_t kept = 0;
+		for (size_t i = 0; i < m_songs.size(); ++i)
+			if (!outdated[i])
+				m_songs[kept++] = std::move(m_songs[i]);
+		m_songs.resize(kept);
+		if (m_index_built)
+			m_index.remove(outdated);
+		for (auto &s : fetched)
+		{
+			if (m_index_built)
+				m_index.add(m_songs.size(), s);
+			m_songs.push_back(std::move(s));
+		}
+		if (m_songs.size() != uris.size())
+			return false;
+	}
+	catch (MPD::ServerError &)
+	{
+		// database changed in the middle of synchronization,
+		// e.g. listed directory was removed in the meantime.
+		return false;
+	}
+	return m_songs.size() == expected_songs;
+#	else
+	(void)expected_songs;
+	return false;
+#	endif // LIBMPDCLIENT_CHECK_VERSION(2, 10, 0)
+}
+
+}
+
+namespace Database {
+
+const std::vector<MPD::Song> &songs()
+{
+	if (!m_songs_verified)
+	{
+		auto stats = Mpd.getStatistics();
+		auto server = serverAddress();
+		auto update_time = stats.dbUpdateTime();
+		if (m_songs_server != server)
+		{
+			m_songs_server.clear();
+			if (loadSnapshot(server))
+				m_songs_server = server;
+		}
+		if (m_songs_server == server && m_songs_update_time != update_time)
+		{
+			// snapshot or songs cached in memory are outdated,
+			// apply changes made to the database since then.
+			if (!syncDatabase(stats.songs()))
+				m_songs_server.clear();
+		}
+		else if (m_songs_server == server)
+		{
+			m_songs_verified = true;
+			return m_songs;
+		}
+		if (m_songs_server != server && !fetchDatabase(stats.songs()))
+		{
+			// songs that were fetched are used until the
+			// database changes, then fetching is retried.
+			m_songs_verified = true;
+			return m_songs;
+		}
+		m_songs_server = server;
+		m_songs_update_time = update_time;
+		saveSnapshot();
+		m_songs_verified = true;
+	}
+	return m_songs;
+}
+
+const SongIndex &index()
+{
+	const auto &all_songs = songs();
+	if (!m_index_built)
+	{
+		m_index.clear();
+		for (size_t i = 0; i < all_songs.size(); ++i)
+			m_index.add(i, all_songs[i]);
+		m_index_built = true;
+	}
+	return m_index;
+}
+
+void invalidate()
+{
+	m_songs_verified = false;
+}
+
+}
@@ -0,0 +1,46 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_DATABASE_H
+#define NCMPCPP_DATABASE_H
+
+#include <vector>
+
+#include "song.h"
+#include "song_index.h"
+
+namespace Database {
+
+/// @return all songs from MPD database. They are read from local
+/// snapshot stored in ncmpcpp directory if it's up to date with the
+/// server, otherwise they are fetched and the snapshot is updated.
+const std::vector<MPD::Song> &songs();
+
+/// @return index of songs returned by songs(). It's built on first
+/// use and kept up to date when the database changes afterwards.
+const SongIndex &index();
+
+/// Requests checking whether cached songs are up to date
+/// with MPD database before they are accessed next time.
+void invalidate();
+
+}
+
+#endif // NCMPCPP_DATABASE_H
@@ -135,6 +135,89 @@ void showSongs(NC::Menu<T> &menu, const MPD::Song &s, const SongList &list, cons
 		menu << NC::Format::NoUnderline;
 }
 
+/// Placement of columns within a list of given width. It depends only on the
+/// width and Config.columns, so it's computed once and then reused for every
+/// row drawn until the width changes.
+class ColumnLayout
+{
+public:
+	struct Cell
+	{
+		const Column *column;
+		int x;
+		// width doesn't include spacing between the column and the next one
+		int width;
+		bool last;
+	};
+
+	ColumnLayout() : m_width(-1), m_columns(nullptr), m_columns_size(0) { }
+
+	const std::vector<Cell> &cells(int width)
+	{
+		// columns are only assigned when configuration is read,
+		// so checking the address of their storage is sufficient.
+		if (width != m_width
+		||  Config.columns.data() != m_columns
+		||  Config.columns.size() != m_columns_size)
+			compute(width);
+		return m_cells;
+	}
+
+private:
+	void compute(int width)
+	{
+		m_width = width;
+		m_columns = Config.columns.data();
+		m_columns_size = Config.columns.size();
+		m_cells.clear();
+
+		int x = 0;
+		int remained_width = width;
+		std::vector<Column>::const_iterator it, last = Config.columns.end() - 1;
+		for (it = Config.columns.begin(); it != Config.columns.end(); ++it)
+		{
+			int column_width;
+			// column has relative width and all after it have fixed width,
+			// so stretch it so it fills whole screen along with these after.
+			if (it->stretch_limit >= 0) // (*)
+				column_width = remained_width - it->stretch_limit;
+			else
+				column_width = it->fixed ? it->width : it->width * width * 0.01;
+			// columns with relative width may shrink to 0, omit them
+			if (column_width == 0)
+				continue;
+			// if column is not last, we need to have spacing between it
+			// and next column, so we substract it now and restore later.
+			if (it != last)
+				--column_width;
+
+			// if column doesn't fit into screen, discard it and any other after it.
+			if (remained_width-column_width < 0 || column_width < 0 /* this one may come from (*) */)
+				break;
+
+			m_cells.push_back(Cell{&*it, x, column_width, it == last});
+			if (it != last)
+			{
+				remained_width -= column_width+1;
+				x += column_width+1;
+			}
+		}
+	}
+
+	int m_width;
+	const Column *m_columns;
+	size_t m_columns_size;
+	std::vector<Cell> m_cells;
+};
+
+bool isPrintableASCII(const std::string &s)
+{
+	for (unsigned char c : s)
+		if (c < 0x20 || c >= 0x7f)
+			return false;
+	return true;
+}
+
 template <typename T>
 void showSongsInColumns(NC::Menu<T> &menu, const MPD::Song &s, const SongList &list)
 {
@@ -144,90 +227,89 @@ void showSongsInColumns(NC::Menu<T> &menu, const MPD::Song &s, const SongList &l
 	bool separate_albums, is_now_playing, is_selected, discard_colors;
 	setProperties(menu, s, list, separate_albums, is_now_playing, is_selected, discard_colors);
 
-	int width;
+	static ColumnLayout layout;
+	// reused between calls, so that reading tags doesn't allocate memory
+	static std::string tags_buffer;
+
+	int prefix_length = 0;
+	if (is_now_playing)
+		prefix_length += Config.now_playing_prefix_length;
+	if (is_selected)
+		prefix_length += Config.selected_item_prefix_length;
+
 	int y = menu.getY();
-	int remained_width = menu.getWidth();
-	std::vector<Column>::const_iterator it, last = Config.columns.end() - 1;
-	for (it = Config.columns.begin(); it != Config.columns.end(); ++it)
+	const auto &cells = layout.cells(menu.getWidth());
+	for (auto cell = cells.begin(); cell != cells.end(); ++cell)
 	{
-		// check current X coordinate
-		int x = menu.getX();
-		// column has relative width and all after it have fixed width,
-		// so stretch it so it fills whole screen along with these after.
-		if (it->stretch_limit >= 0) // (*)
-			width = remained_width - it->stretch_limit;
-		else
-			width = it->fixed ? it->width : it->width * menu.getWidth() * 0.01;
-		// columns with relative width may shrink to 0, omit them
-		if (width == 0)
-			continue;
-		// if column is not last, we need to have spacing between it
-		// and next column, so we substract it now and restore later.
-		if (it != last)
-			--width;
-
-		if (it == Config.columns.begin() && (is_now_playing || is_selected))
+		const Column &column = *cell->column;
+		int x = cell->x;
+		int width = cell->width;
+
+		if (cell == cells.begin() && prefix_length > 0)
 		{
 			// here comes the shitty part. if we applied now playing or selected
 			// prefix, first column's width needs to be properly modified, so
 			// next column is not affected by them. if prefixes fit, we just
 			// subtract their width from allowed column's width. if they don't,
-			// then we pretend that they do, but we adjust current cursor position
-			// so part of them will be overwritten by next column.
-			int offset = 0;
-			if (is_now_playing)
-				offset += Config.now_playing_prefix_length;
-			if (is_selected)
-				offset += Config.selected_item_prefix_length;
-			if (width-offset < 0)
+			// then we pretend that they do, but part of them will be overwritten
+			// by next column.
+			if (width-prefix_length < 0)
 			{
-				remained_width -= width + 1;
-				menu.goToXY(width, y);
-				menu << ' ';
+				if (!cell->last)
+				{
+					menu.goToXY(x + width, y);
+					menu << ' ';
+				}
 				continue;
 			}
-			width -= offset;
-			remained_width -= offset;
+			x += prefix_length;
+			width -= prefix_length;
 		}
 
-		// if column doesn't fit into screen, discard it and any other after it.
-		if (remained_width-width < 0 || width < 0 /* this one may come from (*) */)
-			break;
-
-		std::wstring tag;
-		for (size_t i = 0; i < it->type.length(); ++i)
+		tags_buffer.clear();
+		for (size_t i = 0; i < column.type.length(); ++i)
 		{
-			MPD::Song::GetFunction get = charToGetFunction(it->type[i]);
+			MPD::Song::GetFunction get = charToGetFunction(column.type[i]);
 			assert(get);
-			tag = ToWString(Charset::utf8ToLocale(s.getTags(get)));
-			if (!tag.empty())
+			s.appendTags(tags_buffer, get);
+			if (!tags_buffer.empty())
 				break;
 		}
-		if (tag.empty() && it->display_empty_tag)
-			tag = ToWString(Config.empty_tag);
-		wideCut(tag, width);
+		if (tags_buffer.empty() && column.display_empty_tag)
+			tags_buffer = Config.empty_tag;
 
-		if (!discard_colors && it->color != NC::Color::Default)
-			menu << it->color;
+		if (!discard_colors && column.color != NC::Color::Default)
+			menu << column.color;
 
-		int x_off = 0;
+		menu.goToXY(x, y);
+		whline(menu.raw(), NC::Key::Space, width);
 		// if column uses right alignment, calculate proper offset.
 		// otherwise just assume offset is 0, ie. we start from the left.
-		if (it->right_alignment)
-			x_off = std::max(0, width - int(wideLength(tag)));
-
-		whline(menu.raw(), NC::Key::Space, width);
-		menu.goToXY(x + x_off, y);
-		menu << tag;
-		menu.goToXY(x + width, y);
-		if (it != last)
+		// in the common case of plain ASCII tag, its length is its width.
+		if (isPrintableASCII(tags_buffer))
 		{
-			// add missing width's part and restore the value.
-			menu << ' ';
-			remained_width -= width+1;
+			if (tags_buffer.size() > size_t(width))
+				tags_buffer.resize(width);
+			if (column.right_alignment)
+				x += width - int(tags_buffer.size());
+			menu.goToXY(x, y);
+			menu << tags_buffer;
+		}
+		else
+		{
+			std::wstring tag = ToWString(Charset::utf8ToLocale(tags_buffer));
+			wideCut(tag, width);
+			if (column.right_alignment)
+				x += std::max(0, width - int(wideLength(tag)));
+			menu.goToXY(x, y);
+			menu << tag;
 		}
+		menu.goToXY(cell->x + cell->width, y);
+		// add spacing between the column and the next one
+		if (!cell->last)
+			menu << ' ';
 
-		if (!discard_colors && it->color != NC::Color::Default)
+		if (!discard_colors && column.color != NC::Color::Default)
 			menu << NC::Color::End;
 	}
 
@@ -257,50 +339,33 @@ std::string Display::Columns(size_t list_width)
 	std::string result;
 	if (Config.columns.empty())
 		return result;
-	
-	int width;
-	int remained_width = list_width;
-	std::vector<Column>::const_iterator it, last = Config.columns.end() - 1;
-	for (it = Config.columns.begin(); it != Config.columns.end(); ++it)
+
+	static ColumnLayout layout;
+	for (const auto &cell : layout.cells(list_width))
 	{
-		// column has relative width and all after it have fixed width,
-		// so stretch it so it fills whole screen along with these after.
-		if (it->stretch_limit >= 0) // (*)
-			width = remained_width - it->stretch_limit;
-		else
-			width = it->fixed ? it->width : it->width * list_width * 0.01;
-		// columns with relative width may shrink to 0, omit them
-		if (width == 0)
-			continue;
-		// if column is not last, we need to have spacing between it
-		// and next column, so we substract it now and restore later.
-		if (it != last)
-			--width;
-		
-		// if column doesn't fit into screen, discard it and any other after it.
-		if (remained_width-width < 0 || width < 0 /* this one may come from (*) */)
-			break;
-		
+		const Column &column = *cell.column;
+		int width = cell.width;
+
 		std::wstring name;
-		if (it->name.empty())
+		if (column.name.empty())
 		{
 			size_t j = 0;
 			while (true)
 			{
-				name += toColumnName(it->type[j]);
+				name += toColumnName(column.type[j]);
 				++j;
-				if (j < it->type.length())
+				if (j < column.type.length())
 					name += '/';
 				else
 					break;
 			}
 		}
 		else
-			name = it->name;
+			name = column.name;
 		wideCut(name, width);
 		
 		int x_off = std::max(0, width - int(wideLength(name)));
-		if (it->right_alignment)
+		if (column.right_alignment)
 		{
 			result += std::string(x_off, NC::Key::Space);
 			result += Charset::utf8ToLocale(ToString(name));
@@ -311,12 +376,9 @@ std::string Display::Columns(size_t list_width)
 			result += std::string(x_off, NC::Key::Space);
 		}
 		
-		if (it != last)
-		{
-			// add missing width's part and restore the value.
-			remained_width -= width+1;
+		// add spacing between the column and the next one
+		if (!cell.last)
 			result += ' ';
-		}
 	}
 	
 	return result;
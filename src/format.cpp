@@ -18,9 +18,12 @@
  *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
  ***************************************************************************/
 
+#include <algorithm>
+#include <map>
 #include <stdexcept>
 
 #include "format_impl.h"
+#include "utility/lru_cache.h"
 #include "utility/type_conversions.h"
 
 namespace {
@@ -221,6 +224,243 @@ expressions<CharT> parseBracket(const string<CharT> &s,
 
 namespace Format {
 
+namespace {
+
+// number of results kept per output type, which needs to be
+// just enough for the songs that are formatted most often.
+const size_t cache_capacity = 32;
+
+struct CacheKey
+{
+	CacheKey(const MPD::Song &song_, const void *ast_, unsigned flags_)
+	: song(song_), ast(ast_), flags(flags_)
+	{ }
+
+	bool operator==(const CacheKey &rhs) const
+	{
+		return song.sharesDataWith(rhs.song) && ast == rhs.ast && flags == rhs.flags;
+	}
+
+	MPD::Song song;
+	const void *ast;
+	unsigned flags;
+};
+
+struct CacheKeyHash
+{
+	size_t operator()(const CacheKey &key) const
+	{
+		return MPD::Song::Hash()(key.song)
+		     ^ std::hash<const void *>()(key.ast)
+		     ^ key.flags;
+	}
+};
+
+template <typename ValueT>
+using Cache = LRUCache<CacheKey, ValueT, CacheKeyHash>;
+
+Cache<NC::Buffer> buffer_cache(cache_capacity);
+Cache<NC::WBuffer> wbuffer_cache(cache_capacity);
+Cache<std::string> string_cache(cache_capacity);
+Cache<std::wstring> wstring_cache(cache_capacity);
+
+Cache<NC::Buffer> &cache(NC::Buffer *) { return buffer_cache; }
+Cache<NC::WBuffer> &cache(NC::WBuffer *) { return wbuffer_cache; }
+Cache<std::string> &cache(std::string *) { return string_cache; }
+Cache<std::wstring> &cache(std::wstring *) { return wstring_cache; }
+
+}
+
+template <typename CharT>
+const NC::BasicBuffer<CharT> &printCached(const AST<CharT> &ast, const MPD::Song &song,
+                                          const unsigned flags)
+{
+	auto &c = cache(static_cast<NC::BasicBuffer<CharT> *>(nullptr));
+	CacheKey key(song, &ast, flags);
+	auto result = c.find(key);
+	if (result == nullptr)
+	{
+		NC::BasicBuffer<CharT> buffer;
+		print(ast, buffer, &song, flags);
+		result = &c.insert(key, std::move(buffer));
+	}
+	return *result;
+}
+
+template <typename CharT>
+const std::basic_string<CharT> &stringifyCached(const AST<CharT> &ast, const MPD::Song &song)
+{
+	auto &c = cache(static_cast<std::basic_string<CharT> *>(nullptr));
+	CacheKey key(song, &ast, Flags::Tag);
+	auto result = c.find(key);
+	if (result == nullptr)
+		result = &c.insert(key, stringify(ast, &song));
+	return *result;
+}
+
+template const NC::Buffer &printCached(const AST<char> &, const MPD::Song &, const unsigned);
+template const NC::WBuffer &printCached(const AST<wchar_t> &, const MPD::Song &, const unsigned);
+template const std::string &stringifyCached(const AST<char> &, const MPD::Song &);
+template const std::wstring &stringifyCached(const AST<wchar_t> &, const MPD::Song &);
+
+void clearCache()
+{
+	buffer_cache.clear();
+	wbuffer_cache.clear();
+	string_cache.clear();
+	wstring_cache.clear();
+}
+
+std::pair<size_t, size_t> cacheStatistics()
+{
+	return std::make_pair(
+		buffer_cache.hits() + wbuffer_cache.hits() + string_cache.hits() + wstring_cache.hits(),
+		buffer_cache.misses() + wbuffer_cache.misses() + string_cache.misses() + wstring_cache.misses()
+	);
+}
+
+template <typename CharT>
+struct Program<CharT>::Compiler: boost::static_visitor<void>
+{
+	typedef typename Program<CharT>::Instruction Instruction;
+	typedef typename Program<CharT>::Opcode Opcode;
+
+	Compiler(Program<CharT> &program)
+	: m_program(program)
+	, m_output(true)
+	, m_depth(0)
+	{ }
+
+	void compile(const Expression<CharT> &ex, bool output)
+	{
+		bool was_output = m_output;
+		m_output = output;
+		boost::apply_visitor(*this, ex);
+		m_output = was_output;
+	}
+
+	void operator()(const std::basic_string<CharT> &s)
+	{
+		if (m_output)
+		{
+			m_program.m_strings.push_back(s);
+			add(Opcode::String, m_program.m_strings.size()-1);
+		}
+		else
+			add(Opcode::SetResult, unsigned(s.empty() ? Result::Empty : Result::Ok));
+	}
+
+	void operator()(const NC::Color &c)
+	{
+		if (m_output)
+		{
+			m_program.m_colors.push_back(c);
+			add(Opcode::Color, m_program.m_colors.size()-1);
+		}
+		else
+			add(Opcode::SetResult, unsigned(Result::Empty));
+	}
+
+	void operator()(NC::Format fmt)
+	{
+		if (m_output)
+			add(Opcode::Format, unsigned(fmt));
+		else
+			add(Opcode::SetResult, unsigned(Result::Empty));
+	}
+
+	void operator()(OutputSwitch)
+	{
+		if (m_output)
+			add(Opcode::OutputSwitch);
+		else
+			add(Opcode::SetResult, unsigned(Result::Ok));
+	}
+
+	void operator()(const SongTag &st)
+	{
+		// expressions within groups are compiled twice, but
+		// their tags need to be fetched only once.
+		auto it = m_tags.find(&st);
+		if (it == m_tags.end())
+		{
+			m_program.m_tags.push_back(st);
+			it = m_tags.emplace(&st, m_program.m_tags.size()-1).first;
+		}
+		add(m_output ? Opcode::Tag : Opcode::CheckTag, it->second);
+	}
+
+	// Result of the group is determined first, then if it's Ok
+	// and the group is to be printed, all expressions are printed.
+	void operator()(const Group<CharT> &group)
+	{
+		unsigned slot = m_depth++;
+		m_program.m_groups_depth = std::max(m_program.m_groups_depth, m_depth);
+		std::vector<size_t> jumps;
+		add(Opcode::GroupBegin, slot);
+		for (const auto &ex : group.base())
+		{
+			compile(ex, false);
+			jumps.push_back(add(Opcode::GroupNext, slot));
+		}
+		add(Opcode::GroupEnd, slot);
+		setTarget(jumps);
+		--m_depth;
+
+		if (m_output)
+		{
+			jumps.assign(1, add(Opcode::JumpIfNotOk));
+			for (const auto &ex : group.base())
+				compile(ex, true);
+			add(Opcode::SetResult, unsigned(Result::Ok));
+			setTarget(jumps);
+		}
+	}
+
+	void operator()(const FirstOf<CharT> &first_of)
+	{
+		std::vector<size_t> jumps;
+		for (const auto &ex : first_of.base())
+		{
+			compile(ex, m_output);
+			jumps.push_back(add(Opcode::JumpIfOk));
+		}
+		add(Opcode::SetResult, unsigned(Result::Empty));
+		setTarget(jumps);
+	}
+
+private:
+	size_t add(Opcode opcode, unsigned arg = 0)
+	{
+		m_program.m_instructions.push_back(Instruction(opcode, arg));
+		return m_program.m_instructions.size()-1;
+	}
+
+	// make given jumps point past the last instruction
+	void setTarget(const std::vector<size_t> &jumps)
+	{
+		for (auto i : jumps)
+			m_program.m_instructions[i].target = m_program.m_instructions.size();
+	}
+
+	Program<CharT> &m_program;
+	std::map<const SongTag *, unsigned> m_tags;
+	bool m_output;
+	unsigned m_depth;
+};
+
+template <typename CharT>
+Program<CharT>::Program(const std::vector<Expression<CharT>> &expressions)
+: m_groups_depth(0)
+{
+	Compiler compiler(*this);
+	for (const auto &ex : expressions)
+		compiler.compile(ex, true);
+}
+
+template struct Program<char>;
+template struct Program<wchar_t>;
+
 AST<char> parse(const std::string &s, const unsigned flags)
 {
 	return AST<char>(parseBracket(s, s.begin(), s.end(), flags));
@@ -37,12 +37,11 @@ const unsigned Tag = 8;
 const unsigned All = Color | Format | OutputSwitch | Tag;
 }
 
-enum class ListType { Group, FirstOf, AST };
+enum class ListType { Group, FirstOf };
 
 template <ListType, typename> struct List;
 template <typename CharT> using Group = List<ListType::Group, CharT>;
 template <typename CharT> using FirstOf = List<ListType::FirstOf, CharT>;
-template <typename CharT> using AST = List<ListType::AST, CharT>;
 
 struct OutputSwitch { };
 
@@ -90,8 +89,79 @@ private:
 	Base m_base;
 };
 
-template <typename CharT, typename VisitorT>
-void visit(VisitorT &visitor, const AST<CharT> &ast);
+/// Expressions compiled into a flat list of instructions. Each one is
+/// compiled either into instructions that output it or into ones that
+/// only determine its result (e.g. when checking whether to output
+/// a group), so the program can be run in a single pass.
+template <typename CharT>
+struct Program
+{
+	enum class Opcode : unsigned char {
+		String,       // output strings[arg]
+		Color,        // output colors[arg]
+		Format,       // output NC::Format(arg)
+		OutputSwitch, // switch to the second output
+		Tag,          // output tags[arg] if it's not missing
+		CheckTag,     // check whether tags[arg] is missing
+		SetResult,    // set result to Result(arg)
+		GroupBegin,   // start accumulating results in slot arg
+		GroupNext,    // accumulate result in slot arg, if it's missing jump to target
+		GroupEnd,     // set result to the one accumulated in slot arg
+		JumpIfOk,     // jump to target if result is Ok
+		JumpIfNotOk   // jump to target if result is not Ok
+	};
+
+	struct Instruction
+	{
+		Instruction(Opcode opcode_, unsigned arg_ = 0)
+		: opcode(opcode_), arg(arg_), target(0)
+		{ }
+
+		Opcode opcode;
+		unsigned arg;
+		unsigned target;
+	};
+
+	Program() : m_groups_depth(0) { }
+	Program(const std::vector<Expression<CharT>> &expressions);
+
+	const std::vector<Instruction> &instructions() const { return m_instructions; }
+	const std::vector<std::basic_string<CharT>> &strings() const { return m_strings; }
+	const std::vector<NC::Color> &colors() const { return m_colors; }
+	const std::vector<SongTag> &tags() const { return m_tags; }
+
+	/// @return number of slots needed for results of nested groups
+	unsigned groupsDepth() const { return m_groups_depth; }
+
+private:
+	struct Compiler;
+
+	std::vector<Instruction> m_instructions;
+	std::vector<std::basic_string<CharT>> m_strings;
+	std::vector<NC::Color> m_colors;
+	std::vector<SongTag> m_tags;
+	unsigned m_groups_depth;
+};
+
+/// Parsed format along with the program it's printed with.
+template <typename CharT>
+struct AST
+{
+	typedef std::vector<Expression<CharT>> Base;
+
+	AST() { }
+	AST(Base &&base_)
+	: m_base(std::move(base_))
+	, m_program(m_base)
+	{ }
+
+	const Base &base() const { return m_base; }
+	const Program<CharT> &program() const { return m_program; }
+
+private:
+	Base m_base;
+	Program<CharT> m_program;
+};
 
 template <typename CharT, typename ItemT>
 void print(const AST<CharT> &ast, NC::Menu<ItemT> &menu, const MPD::Song *song,
@@ -101,9 +171,33 @@ template <typename CharT>
 void print(const AST<CharT> &ast, NC::BasicBuffer<CharT> &buffer,
            const MPD::Song *song, const unsigned flags = Flags::All);
 
+/// Appends formatted song to the result.
+template <typename CharT>
+void stringify(const AST<CharT> &ast, const MPD::Song *song, std::basic_string<CharT> &result);
+
 template <typename CharT>
 std::basic_string<CharT> stringify(const AST<CharT> &ast, const MPD::Song *song);
 
+/// Prints the song to a buffer. Results for recently printed songs are kept,
+/// so that songs shown all the time (e.g. the one that is playing) aren't
+/// formatted anew every time they're drawn. The song needs to be the one
+/// fetched from MPD, its local modifications are not taken into account.
+/// Returned reference stays valid at least until the next call.
+template <typename CharT>
+const NC::BasicBuffer<CharT> &printCached(const AST<CharT> &ast, const MPD::Song &song,
+                                          const unsigned flags = Flags::All);
+
+/// @see printCached()
+template <typename CharT>
+const std::basic_string<CharT> &stringifyCached(const AST<CharT> &ast, const MPD::Song &song);
+
+/// Forgets results of printCached() and stringifyCached().
+void clearCache();
+
+/// @return numbers of results of printCached() and stringifyCached()
+/// that were found in cache and that had to be formatted.
+std::pair<size_t, size_t> cacheStatistics();
+
 AST<char> parse(const std::string &s, const unsigned flags = Flags::All);
 AST<wchar_t> parse(const std::wstring &ws, const unsigned flags = Flags::All);
 
@@ -21,8 +21,6 @@
 #ifndef NCMPCPP_HAVE_FORMAT_IMPL_H
 #define NCMPCPP_HAVE_FORMAT_IMPL_H
 
-#include <boost/variant.hpp>
-
 #include "format.h"
 #include "menu.h"
 #include "song.h"
@@ -66,114 +64,155 @@ inline Result &operator+=(Result &base, Result result)
 }*/
 
 template <typename CharT, typename OutputT, typename SecondOutputT = OutputT>
-struct Printer: boost::static_visitor<Result>
+struct Printer
 {
 	typedef std::basic_string<CharT> StringT;
+	typedef typename Program<CharT>::Opcode Opcode;
 
 	Printer(OutputT &os, const MPD::Song *song, SecondOutputT *second_os, const unsigned flags)
 	: m_output(os)
 	, m_song(song)
 	, m_output_switched(false)
 	, m_second_os(second_os)
-	, m_no_output(0)
 	, m_flags(flags)
 	{ }
 
-	Result operator()(const StringT &s)
+	void run(const Program<CharT> &program)
 	{
-		if (!s.empty())
+		// tags are fetched at most once, even if they're both
+		// checked and printed (which is the case within groups).
+		State &state = localState();
+		state.tags.resize(program.tags().size());
+		state.tag_results.assign(program.tags().size(), Result::Empty);
+		state.group_results.resize(program.groupsDepth());
+
+		const auto &instructions = program.instructions();
+		Result result = Result::Empty;
+		for (size_t i = 0; i < instructions.size();)
 		{
-			output(s);
-			return Result::Ok;
+			const auto &in = instructions[i++];
+			switch (in.opcode)
+			{
+				case Opcode::String:
+				{
+					const auto &s = program.strings()[in.arg];
+					if (!s.empty())
+					{
+						output(s);
+						result = Result::Ok;
+					}
+					else
+						result = Result::Empty;
+					break;
+				}
+				case Opcode::Color:
+					if (m_flags & Flags::Color)
+						output(program.colors()[in.arg]);
+					result = Result::Empty;
+					break;
+				case Opcode::Format:
+					if (m_flags & Flags::Format)
+						output(NC::Format(in.arg));
+					result = Result::Empty;
+					break;
+				case Opcode::OutputSwitch:
+					m_output_switched = true;
+					result = Result::Ok;
+					break;
+				case Opcode::Tag:
+					result = tag(program, state, in.arg);
+					if (result == Result::Ok)
+						output(state.tags[in.arg]);
+					break;
+				case Opcode::CheckTag:
+					result = tag(program, state, in.arg);
+					break;
+				case Opcode::SetResult:
+					result = Result(in.arg);
+					break;
+				case Opcode::GroupBegin:
+					state.group_results[in.arg] = Result::Empty;
+					break;
+				// If all Empty -> Empty, if any Ok -> continue with Ok, if any Missing -> stop with Empty.
+				case Opcode::GroupNext:
+					state.group_results[in.arg] += result;
+					if (state.group_results[in.arg] == Result::Missing)
+					{
+						result = Result::Empty;
+						i = in.target;
+					}
+					break;
+				case Opcode::GroupEnd:
+					result = state.group_results[in.arg];
+					break;
+				case Opcode::JumpIfOk:
+					if (result == Result::Ok)
+						i = in.target;
+					break;
+				case Opcode::JumpIfNotOk:
+					if (result != Result::Ok)
+						i = in.target;
+					break;
+			}
 		}
-		else
-			return Result::Empty;
 	}
 
-	Result operator()(const NC::Color &c)
-	{
-		if (m_flags & Flags::Color)
-			output(c);
-		return Result::Empty;
-	}
-
-	Result operator()(NC::Format fmt)
+private:
+	// buffers reused by all printers running in the same thread,
+	// so that printing tags doesn't allocate memory in steady state.
+	struct State
 	{
-		if (m_flags & Flags::Format)
-			output(fmt);
-		return Result::Empty;
-	}
+		std::vector<StringT> tags;
+		std::vector<Result> tag_results;
+		std::vector<Result> group_results;
+		std::string utf8_tags;
+	};
 
-	Result operator()(OutputSwitch)
+	static State &localState()
 	{
-		if (!m_no_output)
-			m_output_switched = true;
-		return Result::Ok;
+		static thread_local State state;
+		return state;
 	}
 
-	Result operator()(const SongTag &st)
+	Result tag(const Program<CharT> &program, State &state, unsigned idx) const
 	{
-		StringT tags;
-		if (m_flags & Flags::Tag && m_song != nullptr)
+		Result &result = state.tag_results[idx];
+		if (result == Result::Empty)
 		{
-			tags = convertString<CharT, char>::apply(
-				m_song->getTags(st.function())
-			);
-		}
-		if (!tags.empty())
-		{
-			if (st.delimiter() > 0)
+			const SongTag &st = program.tags()[idx];
+			StringT &tags = state.tags[idx];
+			tags.clear();
+			if (m_flags & Flags::Tag && m_song != nullptr)
+				appendTags(state, tags, st.function());
+			if (!tags.empty())
 			{
-				// shorten date/length by simple truncation
-				if (st.function() == &MPD::Song::getDate || st.function() == &MPD::Song::getLength)
-					tags.resize(st.delimiter());
-				else
-					tags = wideShorten(tags, st.delimiter());
-			}
-			output(tags);
-			return Result::Ok;
-		}
-		else
-			return Result::Missing;
-	}
-
-	// If all Empty -> Empty, if any Ok -> continue with Ok, if any Missing -> stop with Empty.
-	Result operator()(const Group<CharT> &group)
-	{
-		auto visit = [this, &group] {
-			Result result = Result::Empty;
-			for (const auto &ex : group.base())
-			{
-				result += boost::apply_visitor(*this, ex);
-				if (result == Result::Missing)
+				if (st.delimiter() > 0)
 				{
-					result = Result::Empty;
-					break;
+					// shorten date/length by simple truncation
+					if (st.function() == &MPD::Song::getDate || st.function() == &MPD::Song::getLength)
+						tags.resize(st.delimiter());
+					else
+						tags = wideShorten(tags, st.delimiter());
 				}
+				result = Result::Ok;
 			}
-			return result;
-		};
-
-		++m_no_output;
-		Result result = visit();
-		--m_no_output;
-		if (!m_no_output && result == Result::Ok)
-			visit();
+			else
+				result = Result::Missing;
+		}
 		return result;
 	}
 
-	// If all Empty or Missing -> Empty, if any Ok -> stop with Ok.
-	Result operator()(const FirstOf<CharT> &first_of)
+	void appendTags(State &, std::string &tags, MPD::Song::GetFunction f) const
 	{
-		for (const auto &ex : first_of.base())
-		{
-			if (boost::apply_visitor(*this, ex) == Result::Ok)
-				return Result::Ok;
-		}
-		return Result::Empty;
+		m_song->appendTags(tags, f);
+	}
+	void appendTags(State &state, std::wstring &tags, MPD::Song::GetFunction f) const
+	{
+		state.utf8_tags.clear();
+		m_song->appendTags(state.utf8_tags, f);
+		tags += convertString<wchar_t, char>::apply(state.utf8_tags);
 	}
 
-private:
 	// generic version for streams (buffers, menus)
 	template <typename ValueT, typename OutputStreamT>
 	struct output_ {
@@ -207,13 +246,10 @@ private:
 	template <typename ValueT>
 	void output(const ValueT &value) const
 	{
-		if (!m_no_output)
-		{
-			if (m_output_switched && m_second_os != nullptr)
-				output_<ValueT, SecondOutputT>::exec(*m_second_os, value);
-			else
-				output_<ValueT, OutputT>::exec(m_output, value);
-		}
+		if (m_output_switched && m_second_os != nullptr)
+			output_<ValueT, SecondOutputT>::exec(*m_second_os, value);
+		else
+			output_<ValueT, OutputT>::exec(m_output, value);
 	}
 
 	OutputT &m_output;
@@ -222,23 +258,15 @@ private:
 	bool m_output_switched;
 	SecondOutputT *m_second_os;
 
-	unsigned m_no_output;
 	const unsigned m_flags;
 };
 
-template <typename CharT, typename VisitorT>
-void visit(VisitorT &visitor, const AST<CharT> &ast)
-{
-	for (const auto &ex : ast.base())
-		boost::apply_visitor(visitor, ex);
-}
-
 template <typename CharT, typename ItemT>
 void print(const AST<CharT> &ast, NC::Menu<ItemT> &menu, const MPD::Song *song,
            NC::BasicBuffer<CharT> *buffer, const unsigned flags)
 {
 	Printer<CharT, NC::Menu<ItemT>, NC::Buffer> printer(menu, song, buffer, flags);
-	visit(printer, ast);
+	printer.run(ast.program());
 }
 
 template <typename CharT>
@@ -246,15 +274,21 @@ void print(const AST<CharT> &ast, NC::BasicBuffer<CharT> &buffer,
            const MPD::Song *song, const unsigned flags)
 {
 	Printer<CharT, NC::BasicBuffer<CharT>> printer(buffer, song, &buffer, flags);
-	visit(printer, ast);
+	printer.run(ast.program());
+}
+
+template <typename CharT>
+void stringify(const AST<CharT> &ast, const MPD::Song *song, std::basic_string<CharT> &result)
+{
+	Printer<CharT, std::basic_string<CharT>> printer(result, song, &result, Flags::Tag);
+	printer.run(ast.program());
 }
 
 template <typename CharT>
 std::basic_string<CharT> stringify(const AST<CharT> &ast, const MPD::Song *song)
 {
 	std::basic_string<CharT> result;
-	Printer<CharT, std::basic_string<CharT>> printer(result, song, &result, Flags::Tag);
-	visit(printer, ast);
+	stringify(ast, song, result);
 	return result;
 }
 
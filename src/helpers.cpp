@@ -19,13 +19,54 @@
  ***************************************************************************/
 
 #include <algorithm>
+#include <cassert>
 #include <time.h>
+#include <unordered_map>
 
 #include "enums.h"
 #include "helpers.h"
 #include "playlist.h"
 #include "statusbar.h"
 #include "utility/functional.h"
+#include "utility/permutation.h"
+
+namespace {
+
+// positions of songs in lists marked by markSongsInPlaylist
+struct SongPositions
+{
+	size_t list_size;
+	std::unordered_multimap<MPD::Song, size_t, MPD::Song::Hash> positions;
+};
+std::unordered_map<const SongList *, SongPositions> song_positions;
+
+}
+
+IncrementalSearch *IncrementalSearch::m_active = nullptr;
+
+IncrementalSearch::IncrementalSearch()
+{
+	assert(m_active == nullptr);
+	m_active = this;
+}
+
+IncrementalSearch::~IncrementalSearch()
+{
+	m_active = nullptr;
+}
+
+bool IncrementalSearch::isRefinement(const std::string &previous, const std::string &constraint)
+{
+	if (previous == constraint)
+		return true;
+	// a string that contains the constraint also contains its prefix,
+	// provided that both of them are matched literally.
+	auto is_literal = [](const std::string &s) {
+		return s.find_first_of(".[]{}()\\*+?|^$") == std::string::npos;
+	};
+	return constraint.compare(0, previous.length(), previous) == 0
+	    && is_literal(constraint);
+}
 
 const MPD::Song *currentSong(const BaseScreen *screen)
 {
@@ -40,12 +81,12 @@ const MPD::Song *currentSong(const BaseScreen *screen)
 	return ptr;
 }
 
-MPD::SongIterator getDatabaseIterator(MPD::Connection &mpd)
+MPD::ItemIterator getDatabaseIterator(MPD::Connection &mpd)
 {
-	MPD::SongIterator result;
+	MPD::ItemIterator result;
 	try
 	{
-		result = mpd.GetDirectoryRecursive("/");
+		result = mpd.GetDirectoryRecursiveItems("/");
 	}
 	catch (MPD::ClientError &e)
 	{
@@ -67,50 +108,59 @@ typedef std::vector<MPD::Song>::const_iterator VectorSongIterator;
 bool addSongsToPlaylist(VectorSongIterator first, VectorSongIterator last, bool play, int position)
 {
 	bool result = true;
-	auto addSongNoError = [&](VectorSongIterator song) -> int {
-		try
-		{
-			return Mpd.AddSong(*song, position);
-		}
-		catch (MPD::ServerError &e)
-		{
-			Status::handleServerError(e);
-			result = false;
-			return -1;
-		}
-	};
+	auto ids = Mpd.AddSongs(first, last, position, [&result](MPD::ServerError &e) {
+		Status::handleServerError(e);
+		result = false;
+	});
+	if (play)
+	{
+		// play the first song that was successfully added
+		auto id = std::find_if(ids.begin(), ids.end(), [](int song_id) {
+			return song_id >= 0;
+		});
+		if (id != ids.end())
+			Mpd.PlayID(*id);
+	}
+	return result;
+}
 
-	if (last-first >= 1)
+void permutePlaylist(size_t offset, const std::vector<size_t> &permutation)
+{
+	auto steps = planPermutation(permutation, PermutationCommands::SwapsAndRangeMoves);
+	if (steps.empty())
+		return;
+	Mpd.StartCommandsList();
+	for (const auto &step : steps)
 	{
-		int id;
-		while (true)
+		switch (step.type())
 		{
-			id = addSongNoError(first);
-			if (id >= 0)
+			case PermutationStep::Type::Swap:
+				Mpd.Swap(offset+step.first(), offset+step.second());
+				break;
+			case PermutationStep::Type::Move:
+				if (step.end()-step.start() == 1)
+					Mpd.Move(offset+step.start(), offset+step.to());
+				else
+					Mpd.MoveRange(offset+step.start(), offset+step.end(), offset+step.to());
 				break;
-			++first;
-			if (first == last)
-				return result;
-		}
-
-		if (position == -1)
-		{
-			++first;
-			for(; first != last; ++first)
-				addSongNoError(first);
-		}
-		else
-		{
-			++position;
-			--last;
-			for (; first != last; --last)
-				addSongNoError(last);
 		}
-		if (play)
-			Mpd.PlayID(id);
 	}
+	Mpd.CommitCommandsList();
+}
 
-	return result;
+void permuteStoredPlaylist(const std::string &playlist, const std::vector<size_t> &permutation)
+{
+	// stored playlists support only moving single items
+	auto steps = planPermutation(permutation, PermutationCommands::SingleMoves);
+	if (steps.empty())
+		return;
+	Mpd.StartCommandsList();
+	for (const auto &step : steps)
+	{
+		assert(step.type() == PermutationStep::Type::Move);
+		Mpd.PlaylistMove(playlist, step.start(), step.to());
+	}
+	Mpd.CommitCommandsList();
 }
 
 void removeSongFromPlaylist(const SongMenu &playlist, const MPD::Song &s)
@@ -174,12 +224,48 @@ std::string Timestamp(time_t t)
 
 void markSongsInPlaylist(SongList &list)
 {
+	auto &sp = song_positions[&list];
+	sp.positions.clear();
+	size_t pos = 0;
 	MPD::Song *s;
 	for (auto &p : list)
 	{
 		s = p.get<Bit::Song>();
 		if (s != nullptr)
+		{
 			p.get<Bit::Properties>().setBold(myPlaylist->checkForSong(*s));
+			sp.positions.emplace(*s, pos);
+		}
+		++pos;
+	}
+	sp.list_size = pos;
+}
+
+void updateSongsInPlaylist(SongList &list, const std::vector<MPD::Song> &changed_songs)
+{
+	auto sp = song_positions.find(&list);
+	auto first = list.beginS();
+	if (sp == song_positions.end() || sp->second.list_size != size_t(list.endS()-first))
+	{
+		markSongsInPlaylist(list);
+		return;
+	}
+	for (const auto &s : changed_songs)
+	{
+		bool in_playlist = myPlaylist->checkForSong(s);
+		auto range = sp->second.positions.equal_range(s);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			auto p = *(first+it->second);
+			MPD::Song *song = p.get<Bit::Song>();
+			// songs were rearranged since the list was marked
+			if (song == nullptr || *song != s)
+			{
+				markSongsInPlaylist(list);
+				return;
+			}
+			p.get<Bit::Properties>().setBold(in_playlist);
+		}
 	}
 }
 
@@ -21,6 +21,8 @@
 #ifndef NCMPCPP_HELPERS_H
 #define NCMPCPP_HELPERS_H
 
+#include <map>
+
 #include "interfaces.h"
 #include "mpdpp.h"
 #include "screen.h"
@@ -28,6 +30,7 @@
 #include "song_list.h"
 #include "status.h"
 #include "utility/string.h"
+#include "utility/thread_pool.h"
 #include "utility/type_conversions.h"
 #include "utility/wide_string.h"
 
@@ -37,22 +40,179 @@ Iterator wrappedSearch(Iterator begin, Iterator current, Iterator end,
 {
 	if (skip_current)
 		++current;
-	auto it = std::find_if(current, end, pred);
+	auto it = parallelFindIf(current, end, pred);
 	if (it == end && wrap)
 	{
-		it = std::find_if(begin, current, pred);
+		it = parallelFindIf(begin, current, pred);
 		if (it == current)
 			it = end;
 	}
 	return it;
 }
 
+/// While an instance exists (i.e. search constraint is being typed in),
+/// search() remembers positions of items of each searched list that match
+/// consecutive constraints. If a constraint is a literal that extends the
+/// previous one, only items that matched the previous one are checked and
+/// if it's shortened, results for the shorter one are reused.
+struct IncrementalSearch
+{
+	IncrementalSearch();
+	~IncrementalSearch();
+
+	/// @return instance that currently exists or null if there is none.
+	static IncrementalSearch *active() { return m_active; }
+
+	void setConstraint(std::string constraint) { m_constraint = std::move(constraint); }
+
+	/// @return positions of items matching the current constraint.
+	template <typename ItemT, typename PredicateT>
+	const std::vector<size_t> &matches(const NC::Menu<ItemT> &m, const PredicateT &pred);
+
+private:
+	struct Results
+	{
+		std::string constraint;
+		std::vector<size_t> positions;
+	};
+
+	struct ListResults
+	{
+		/// versions of items the results were computed for
+		std::vector<size_t> versions;
+		std::vector<Results> results;
+	};
+
+	/// @return true if all items matching constraint also match previous one.
+	static bool isRefinement(const std::string &previous, const std::string &constraint);
+
+	static IncrementalSearch *m_active;
+
+	std::string m_constraint;
+	std::map<const void *, ListResults> m_results;
+};
+
+template <typename ItemT, typename PredicateT>
+const std::vector<size_t> &IncrementalSearch::matches(const NC::Menu<ItemT> &m, const PredicateT &pred)
+{
+	auto &list = m_results[&m];
+	// positions are valid only as long as the list contains the same items
+	// in the same order, which also covers modifications that keep its size.
+	bool unchanged = list.versions.size() == m.size();
+	for (size_t i = 0; unchanged && i < m.size(); ++i)
+		unchanged = list.versions[i] == m[i].version();
+	if (!unchanged)
+	{
+		list.results.clear();
+		list.versions.resize(m.size());
+		for (size_t i = 0; i < m.size(); ++i)
+			list.versions[i] = m[i].version();
+	}
+
+	auto &results = list.results;
+	while (!results.empty() && !isRefinement(results.back().constraint, m_constraint))
+		results.pop_back();
+	if (!results.empty() && results.back().constraint == m_constraint)
+		return results.back().positions;
+
+	std::vector<size_t> candidates;
+	if (results.empty())
+	{
+		candidates.resize(m.size());
+		for (size_t i = 0; i < candidates.size(); ++i)
+			candidates[i] = i;
+	}
+	else
+		candidates = results.back().positions;
+
+	const size_t part_size = 1024;
+	std::vector<char> matched(candidates.size());
+	ThreadPool::instance().run((candidates.size()+part_size-1)/part_size, [&](size_t part) {
+		PredicateT part_pred(pred);
+		size_t end = std::min(candidates.size(), (part+1)*part_size);
+		for (size_t i = part*part_size; i < end; ++i)
+			matched[i] = part_pred(m[candidates[i]]);
+	});
+	size_t found = 0;
+	for (size_t i = 0; i < candidates.size(); ++i)
+		if (matched[i])
+			candidates[found++] = candidates[i];
+	candidates.resize(found);
+
+	results.push_back(Results{m_constraint, std::move(candidates)});
+	return results.back().positions;
+}
+
+/// Searches for an item satisfying the predicate among items at given (sorted)
+/// positions, starting from the current one, and highlights it if found.
+template <typename ItemT, typename PredicateT>
+bool search(NC::Menu<ItemT> &m, const PredicateT &pred, const std::vector<size_t> &candidates,
+            SearchDirection direction, bool wrap, bool skip_current)
+{
+	if (!pred.defined() || m.empty())
+		return false;
+	auto matches = [&m, &pred](size_t pos) {
+		return pred(m[pos]);
+	};
+	switch (direction)
+	{
+		case SearchDirection::Backward:
+		{
+			// search in positions [0, current] (or [0, current) if current is
+			// skipped) from the end and then, if allowed, in the remaining ones.
+			size_t current = m.choice() + (skip_current ? 0 : 1);
+			auto current_it = std::lower_bound(candidates.begin(), candidates.end(), current);
+			auto it = std::find_if(
+				std::reverse_iterator<decltype(current_it)>(current_it), candidates.rend(), matches
+			);
+			if (it == candidates.rend() && wrap)
+			{
+				it = std::find_if(candidates.rbegin(),
+					std::reverse_iterator<decltype(current_it)>(current_it), matches
+				);
+				if (it.base() == current_it)
+					it = candidates.rend();
+			}
+			if (it != candidates.rend())
+			{
+				m.highlight(*it);
+				return true;
+			}
+			break;
+		}
+		case SearchDirection::Forward:
+		{
+			size_t current = m.choice() + (skip_current ? 1 : 0);
+			auto current_it = std::lower_bound(candidates.begin(), candidates.end(), current);
+			auto it = std::find_if(current_it, candidates.end(), matches);
+			if (it == candidates.end() && wrap)
+			{
+				it = std::find_if(candidates.begin(), current_it, matches);
+				if (it == current_it)
+					it = candidates.end();
+			}
+			if (it != candidates.end())
+			{
+				m.highlight(*it);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
 template <typename ItemT, typename PredicateT>
 bool search(NC::Menu<ItemT> &m, const PredicateT &pred,
             SearchDirection direction, bool wrap, bool skip_current)
 {
 	bool result = false;
-	if (pred.defined())
+	if (pred.defined() && IncrementalSearch::active() != nullptr)
+	{
+		result = search(m, pred, IncrementalSearch::active()->matches(m, pred),
+			direction, wrap, skip_current
+		);
+	}
+	else if (pred.defined())
 	{
 		switch (direction)
 		{
@@ -240,7 +400,7 @@ void moveSelectedItemsDown(NC::Menu<MPD::Song> &m, F swap_fun)
 }
 
 template <typename F>
-void moveSelectedItemsTo(NC::Menu<MPD::Song> &m, F move_fun)
+void moveSelectedItemsTo(NC::Menu<MPD::Song> &m, F permute_fun)
 {
 	// FIXME: make it not look like shit
 	auto cur_ptr = &m.current()->value();
@@ -259,34 +419,25 @@ void moveSelectedItemsTo(NC::Menu<MPD::Song> &m, F move_fun)
 	//(this also handles case when list.size() == 1)
 	if (pos >= (list.front() - begin) && pos <= (list.back() - begin))
 		return;
-	int diff = pos - (list.front() - begin);
-	Mpd.StartCommandsList();
-	if (diff > 0) // move down
+	// selected items end up right before the current one
+	std::vector<size_t> permutation;
+	permutation.reserve(m.size());
+	ptrdiff_t i = 0;
+	for (auto it = m.begin(); it != m.end(); ++it, ++i)
 	{
-		pos -= list.size();
-		size_t i = list.size()-1;
-		for (auto it = list.rbegin(); it != list.rend(); ++it, --i)
-			move_fun(&Mpd, *it - begin, pos+i);
-		Mpd.CommitCommandsList();
-		i = list.size()-1;
-		for (auto it = list.rbegin(); it != list.rend(); ++it, --i)
-		{
-			(*it)->setSelected(false);
-			m[pos+i].setSelected(true);
-		}
+		if (i == pos)
+			for (const auto &s : list)
+				permutation.push_back(s - begin);
+		if (!it->isSelected())
+			permutation.push_back(i);
 	}
-	else if (diff < 0) // move up
+	permute_fun(permutation);
+	if (pos > (list.front() - begin)) // moved down
+		pos -= list.size();
+	for (auto it = list.begin(); it != list.end(); ++it, ++pos)
 	{
-		size_t i = 0;
-		for (auto it = list.begin(); it != list.end(); ++it, ++i)
-			move_fun(&Mpd, *it - begin, pos+i);
-		Mpd.CommitCommandsList();
-		i = 0;
-		for (auto it = list.begin(); it != list.end(); ++it, ++i)
-		{
-			(*it)->setSelected(false);
-			m[pos+i].setSelected(true);
-		}
+		(*it)->setSelected(false);
+		m[pos].setSelected(true);
 	}
 }
 
@@ -395,16 +546,31 @@ bool addSongsToPlaylist(std::vector<MPD::Song>::const_iterator first,
 
 bool addSongToPlaylist(const MPD::Song &s, bool play, int position = -1);
 
+/// Rearranges songs in the playlist so that the one at position
+/// offset+permutation[i] ends up at position offset+i.
+void permutePlaylist(size_t offset, const std::vector<size_t> &permutation);
+/// Rearranges songs in the stored playlist so that the one at
+/// position permutation[i] ends up at position i.
+void permuteStoredPlaylist(const std::string &playlist, const std::vector<size_t> &permutation);
+
 const MPD::Song *currentSong(const BaseScreen *screen);
 
-MPD::SongIterator getDatabaseIterator(MPD::Connection &mpd);
+MPD::ItemIterator getDatabaseIterator(MPD::Connection &mpd);
 
 std::string timeFormat(const char *format, time_t t);
 
 std::string Timestamp(time_t t);
 
+/// Marks songs in the list that are in the playlist and remembers their
+/// positions for updateSongsInPlaylist. Needs to be called whenever the
+/// list is filled with new songs.
 void markSongsInPlaylist(SongList &list);
 
+/// Updates marks of given songs (whose presence in the playlist changed)
+/// only. If the list was modified since it was marked, all songs in it
+/// are marked anew.
+void updateSongsInPlaylist(SongList &list, const std::vector<MPD::Song> &changed_songs);
+
 std::wstring Scroller(const std::wstring &str, size_t &pos, size_t width);
 void writeCyclicBuffer(const NC::WBuffer &buf, NC::Window &w, size_t &start_pos,
                        size_t width, const std::wstring &separator);
@@ -25,6 +25,7 @@
 #include <cassert>
 
 #include "charset.h"
+#include "database.h"
 #include "display.h"
 #include "helpers.h"
 #include "global.h"
@@ -75,7 +76,6 @@ MPD::SongIterator getSongsFromAlbum(const AlbumEntry &album)
 }
 
 std::string AlbumToString(const AlbumEntry &ae);
-std::string SongToString(const MPD::Song &s);
 
 bool TagEntryMatcher(const Regex::Regex &rx, const MediaLibrary::PrimaryTag &tagmtime);
 bool AlbumEntryMatcher(const Regex::Regex &rx, const NC::Menu<AlbumEntry>::Item &item, bool filter);
@@ -91,6 +91,7 @@ struct SortSongs {
 	
 	LocaleStringComparison m_cmp;
 	std::ptrdiff_t m_offset;
+	std::string m_a_tags, m_b_tags;
 	
 public:
 	SortSongs(bool disc_only)
@@ -101,8 +102,11 @@ public:
 	}
 	bool operator()(const MPD::Song &a, const MPD::Song &b) {
 		for (auto get = GetFuns.begin()+m_offset; get != GetFuns.end(); ++get) {
-			int ret = m_cmp(a.getTags(*get),
-			                b.getTags(*get));
+			m_a_tags.clear();
+			a.appendTags(m_a_tags, *get);
+			m_b_tags.clear();
+			b.appendTags(m_b_tags, *get);
+			int ret = m_cmp(m_a_tags, m_b_tags);
 			if (ret != 0)
 				return ret < 0;
 		}
@@ -149,6 +153,26 @@ public:
 			return m_cmp(a.album(), b.album()) < 0;
 		}
 	}
+
+	std::string key(const AlbumEntry &a) const {
+		const Album &album = a.entry();
+		// collation keys don't contain null characters, so they
+		// can be used as separators of the key's components.
+		std::string result = m_cmp.key(album.tag());
+		result += '\0';
+		result += m_cmp.key(album.date());
+		result += '\0';
+		result += m_cmp.key(album.album());
+		return result;
+	}
+
+	template <typename Iterator>
+	void sort(Iterator first, Iterator last) const {
+		if (Config.media_library_sort_by_mtime)
+			std::sort(first, last, *this);
+		else
+			sortByKey(first, last, [this](const AlbumEntry &a) { return key(a); });
+	}
 };
 
 class SortPrimaryTags {
@@ -163,6 +187,14 @@ public:
 		else
 			return m_cmp(a.tag(), b.tag()) < 0;
 	}
+
+	template <typename Iterator>
+	void sort(Iterator first, Iterator last) const {
+		if (Config.media_library_sort_by_mtime)
+			std::sort(first, last, *this);
+		else
+			sortByKey(first, last, [this](const PrimaryTag &t) { return m_cmp.key(t.tag()); });
+	}
 };
 
 }
@@ -283,18 +315,18 @@ void MediaLibrary::update()
 		{
 			m_albums_update_request = false;
 			std::map<std::tuple<std::string, std::string, std::string>, time_t> albums;
-			for (MPD::SongIterator s = getDatabaseIterator(Mpd), end; s != end; ++s)
+			for (const auto &s : Database::songs())
 			{
 				std::string tag;
 				unsigned idx = 0;
-				while (!(tag = s->get(Config.media_lib_primary_tag, idx++)).empty())
+				while (!(tag = s.get(Config.media_lib_primary_tag, idx++)).empty())
 				{
-					auto key = std::make_tuple(std::move(tag), s->getAlbum(), s->getDate());
+					auto key = std::make_tuple(std::move(tag), s.getAlbum(), s.getDate());
 					auto it = albums.find(key);
 					if (it == albums.end())
-						albums[std::move(key)] = s->getMTime();
+						albums[std::move(key)] = s.getMTime();
 					else
-						it->second = s->getMTime();
+						it->second = s.getMTime();
 				}
 			}
 			size_t idx = 0;
@@ -314,7 +346,7 @@ void MediaLibrary::update()
 			}
 			if (idx < Albums.size())
 				Albums.resizeList(idx);
-			std::sort(Albums.beginV(), Albums.endV(), SortAlbumEntries());
+			SortAlbumEntries().sort(Albums.beginV(), Albums.endV());
 			Albums.refresh();
 		}
 	}
@@ -326,17 +358,17 @@ void MediaLibrary::update()
 			std::map<std::string, time_t> tags;
 			if (Config.media_library_sort_by_mtime)
 			{
-				for (MPD::SongIterator s = getDatabaseIterator(Mpd), end; s != end; ++s)
+				for (const auto &s : Database::songs())
 				{
 					std::string tag;
 					unsigned idx = 0;
-					while (!(tag = s->get(Config.media_lib_primary_tag, idx++)).empty())
+					while (!(tag = s.get(Config.media_lib_primary_tag, idx++)).empty())
 					{
 						auto it = tags.find(tag);
 						if (it == tags.end())
-							tags[std::move(tag)] = s->getMTime();
+							tags[std::move(tag)] = s.getMTime();
 						else
-							it->second = std::max(it->second, s->getMTime());
+							it->second = std::max(it->second, s.getMTime());
 					}
 				}
 			}
@@ -358,7 +390,7 @@ void MediaLibrary::update()
 			}
 			if (idx < Tags.size())
 				Tags.resizeList(idx);
-			std::sort(Tags.beginV(), Tags.endV(), SortPrimaryTags());
+			SortPrimaryTags().sort(Tags.beginV(), Tags.endV());
 			Tags.refresh();
 		}
 		
@@ -400,7 +432,7 @@ void MediaLibrary::update()
 			}
 			if (idx < Albums.size())
 				Albums.resizeList(idx);
-			std::sort(Albums.beginV(), Albums.endV(), SortAlbumEntries());
+			SortAlbumEntries().sort(Albums.beginV(), Albums.endV());
 			if (albums.size() > 1)
 			{
 				Albums.addSeparator();
@@ -426,23 +458,15 @@ void MediaLibrary::update()
 		size_t idx = 0;
 		for (MPD::SongIterator s = Mpd.CommitSearchSongs(), end; s != end; ++s, ++idx)
 		{
-			bool in_playlist = myPlaylist->checkForSong(*s);
 			if (idx < Songs.size())
-			{
 				Songs[idx].value() = std::move(*s);
-				Songs[idx].setBold(in_playlist);
-			}
 			else
-			{
-				auto properties = NC::List::Properties::Selectable;
-				if (in_playlist)
-					properties |= NC::List::Properties::Bold;
-				Songs.addItem(std::move(*s), properties);
-			}
+				Songs.addItem(std::move(*s));
 		};
 		if (idx < Songs.size())
 			Songs.resizeList(idx);
 		std::sort(Songs.begin(), Songs.end(), SortSongs(!album.isAllTracksEntry()));
+		markSongsInPlaylist(Songs);
 		Songs.refresh();
 	}
 }
@@ -822,7 +846,7 @@ void MediaLibrary::toggleSortMode()
 		Config.media_library_sort_by_mtime ? "modification time" : "name");
 	if (hasTwoColumns)
 	{
-		std::sort(Albums.beginV(), Albums.endV(), SortAlbumEntries());
+		SortAlbumEntries().sort(Albums.beginV(), Albums.endV());
 		Albums.refresh();
 		Songs.clear();
 		if (Config.titles_visibility)
@@ -838,7 +862,7 @@ void MediaLibrary::toggleSortMode()
 		// if we already have modification times, just resort. otherwise refetch the list.
 		if (!Tags.empty() && Tags[0].value().mtime() > 0)
 		{
-			std::sort(Tags.beginV(), Tags.endV(), SortPrimaryTags());
+			SortPrimaryTags().sort(Tags.beginV(), Tags.endV());
 			Tags.refresh();
 		}
 		else
@@ -884,7 +908,7 @@ void MediaLibrary::LocateSong(const MPD::Song &s)
 			// possible to list all of the library, e.g. mopidy with mopidy-spotify.
 			// To workaround this we simply insert the missing tag.
 			Tags.addItem(PrimaryTag(primary_tag, s.getMTime()));
-			std::sort(Tags.beginV(), Tags.endV(), SortPrimaryTags());
+			SortPrimaryTags().sort(Tags.beginV(), Tags.endV());
 			Tags.refresh();
 			MoveToTag(Tags, primary_tag);
 		}
@@ -923,7 +947,7 @@ void MediaLibrary::LocateSong(const MPD::Song &s)
 			Albums.addItem(AlbumEntry(
 				Album(primary_tag, s.getAlbum(), s.getDate(), s.getMTime())
 			));
-			std::sort(Albums.beginV(), Albums.endV(), SortAlbumEntries());
+			SortAlbumEntries().sort(Albums.beginV(), Albums.endV());
 			Albums.refresh();
 			MoveToAlbum(Albums, primary_tag, s);
 		}
@@ -975,13 +999,6 @@ std::string AlbumToString(const AlbumEntry &ae)
 	return result;
 }
 
-std::string SongToString(const MPD::Song &s)
-{
-	return Format::stringify<char>(
-		Config.song_library_format, &s
-	);
-}
-
 bool TagEntryMatcher(const Regex::Regex &rx, const PrimaryTag &pt)
 {
 	return Regex::search(pt.tag(), rx);
@@ -996,7 +1013,10 @@ bool AlbumEntryMatcher(const Regex::Regex &rx, const NC::Menu<AlbumEntry>::Item
 
 bool SongEntryMatcher(const Regex::Regex &rx, const MPD::Song &s)
 {
-	return Regex::search(SongToString(s), rx);
+	static thread_local std::string song_string;
+	song_string.clear();
+	Format::stringify<char>(Config.song_library_format, &s, song_string);
+	return Regex::search(song_string, rx);
 }
 
 bool MoveToTag(NC::Menu<PrimaryTag> &tags, const std::string &primary_tag)
@@ -24,6 +24,7 @@
 #include <boost/iterator/indirect_iterator.hpp>
 #include <boost/iterator/transform_iterator.hpp>
 #include <boost/range/detail/any_iterator.hpp>
+#include <atomic>
 #include <cassert>
 #include <functional>
 #include <iterator>
@@ -50,44 +51,33 @@ struct List
 
 		Properties(Type properties = Selectable)
 		: m_properties(properties)
+		, m_version(nextVersion())
 		{ }
 
 		void setBold(bool is_bold)
 		{
-			if (is_bold)
-				m_properties |= Bold;
-			else
-				m_properties &= ~Bold;
+			setProperties(is_bold ? m_properties | Bold : m_properties & ~Bold);
 		}
 		void setSelectable(bool is_selectable)
 		{
-			if (is_selectable)
-				m_properties |= Selectable;
-			else
-				m_properties &= ~(Selectable | Selected);
+			setProperties(is_selectable
+				? m_properties | Selectable
+				: m_properties & ~(Selectable | Selected)
+			);
 		}
 		void setSelected(bool is_selected)
 		{
 			if (!isSelectable())
 				return;
-			if (is_selected)
-				m_properties |= Selected;
-			else
-				m_properties &= ~Selected;
+			setProperties(is_selected ? m_properties | Selected : m_properties & ~Selected);
 		}
 		void setInactive(bool is_inactive)
 		{
-			if (is_inactive)
-				m_properties |= Inactive;
-			else
-				m_properties &= ~Inactive;
+			setProperties(is_inactive ? m_properties | Inactive : m_properties & ~Inactive);
 		}
 		void setSeparator(bool is_separator)
 		{
-			if (is_separator)
-				m_properties |= Separator;
-			else
-				m_properties &= ~Separator;
+			setProperties(is_separator ? m_properties | Separator : m_properties & ~Separator);
 		}
 
 		bool isBold() const { return m_properties & Bold; }
@@ -96,8 +86,32 @@ struct List
 		bool isInactive() const { return m_properties & Inactive; }
 		bool isSeparator() const { return m_properties & Separator; }
 
+		/// @return number that is unique among all items and their states, i.e.
+		/// it changes whenever properties or value of the item may change.
+		size_t version() const { return m_version; }
+
+	protected:
+		void changed() { m_version = nextVersion(); }
+
 	private:
+		static size_t nextVersion()
+		{
+			// items may be accessed by multiple threads while searched
+			static std::atomic<size_t> version(0);
+			return ++version;
+		}
+
+		void setProperties(unsigned properties)
+		{
+			if (properties != m_properties)
+			{
+				m_properties = properties;
+				changed();
+			}
+		}
+
 		unsigned m_properties;
+		size_t m_version;
 	};
 
 	template <typename ValueT>
@@ -124,6 +138,17 @@ struct List
 	virtual ConstIterator beginP() const = 0;
 	virtual Iterator endP() = 0;
 	virtual ConstIterator endP() const = 0;
+
+	/// Makes all lists draw their items anew on the next refresh. Needs to be
+	/// called if something apart from items that they're displayed with changes.
+	static void invalidateAll() { ++generation(); }
+
+protected:
+	static unsigned &generation()
+	{
+		static unsigned value = 0;
+		return value;
+	}
 };
 
 inline List::Properties::Type operator|(List::Properties::Type lhs, List::Properties::Type rhs)
@@ -180,10 +205,10 @@ template <typename ItemT> struct Menu : Window, List
 		, m_value(value_)
 		{ }
 		
-		ItemT &value() { return m_value; }
+		ItemT &value() { changed(); return m_value; }
 		const ItemT &value() const { return m_value; }
 		
-		ItemT &operator*() { return m_value; }
+		ItemT &operator*() { changed(); return m_value; }
 		const ItemT &operator*() const { return m_value; }
 
 	private:
@@ -230,7 +255,7 @@ template <typename ItemT> struct Menu : Window, List
 	/// @see setItemDisplayer()
 	typedef std::function<void(Menu<ItemT> &)> ItemDisplayer;
 	
-	Menu() { }
+	Menu() : m_rows_beginning(0), m_rows_width(0), m_rows_generation(0) { }
 	
 	Menu(size_t startx, size_t starty, size_t width, size_t height,
 			const std::string &title, Color color, Border border);
@@ -241,7 +266,15 @@ template <typename ItemT> struct Menu : Window, List
 	
 	/// Sets helper function that is responsible for displaying items
 	/// @param ptr function pointer that matches the ItemDisplayer prototype
-	void setItemDisplayer(const ItemDisplayer &f) { m_item_displayer = f; }
+	void setItemDisplayer(const ItemDisplayer &f)
+	{
+		m_item_displayer = f;
+		m_rows.clear();
+	}
+	
+	/// Drops lines remembered by refresh(). Needs to be called when state
+	/// other than the items that the item displayer depends on changes.
+	void invalidate() { m_rows.clear(); }
 	
 	/// Resizes the list to given size (adequate to std::vector::resize())
 	/// @param size requested size
@@ -302,16 +335,28 @@ template <typename ItemT> struct Menu : Window, List
 	/// Sets prefix, that is put before each selected item to indicate its selection
 	/// Note that the passed variable is not deleted along with menu object.
 	/// @param b pointer to buffer that contains the prefix
-	void setSelectedPrefix(const Buffer &b) { m_selected_prefix = b; }
+	void setSelectedPrefix(const Buffer &b)
+	{
+		m_selected_prefix = b;
+		m_rows.clear();
+	}
 	
 	/// Sets suffix, that is put after each selected item to indicate its selection
 	/// Note that the passed variable is not deleted along with menu object.
 	/// @param b pointer to buffer that contains the suffix
-	void setSelectedSuffix(const Buffer &b) { m_selected_suffix = b; }
+	void setSelectedSuffix(const Buffer &b)
+	{
+		m_selected_suffix = b;
+		m_rows.clear();
+	}
 	
 	/// Sets custom color of highlighted position
 	/// @param col custom color
-	void setHighlightColor(Color color) { m_highlight_color = std::move(color); }
+	void setHighlightColor(Color color)
+	{
+		m_highlight_color = std::move(color);
+		m_rows.clear();
+	}
 	
 	/// @return state of highlighting
 	bool isHighlighted() { return m_highlight_enabled; }
@@ -401,6 +446,25 @@ template <typename ItemT> struct Menu : Window, List
 	}
 
 private:
+	/// Line of the window as it was drawn by item displayer, so that
+	/// it can be put back as long as it's drawn from the same state.
+	struct Row
+	{
+		Row() : position(-1), version(0), next_version(0), is_highlighted(false) { }
+
+		size_t position;
+		size_t version;
+		// items can be displayed differently depending
+		// on the next one (e.g. separators between albums).
+		size_t next_version;
+		bool is_highlighted;
+#		ifdef NCMPCPP_UNICODE
+		std::vector<cchar_t> cells;
+#		else
+		std::vector<chtype> cells;
+#		endif // NCMPCPP_UNICODE
+	};
+
 	bool isHighlightable(size_t pos)
 	{
 		return !m_items[pos].isSeparator()
@@ -424,6 +488,11 @@ private:
 	
 	Buffer m_selected_prefix;
 	Buffer m_selected_suffix;
+
+	std::vector<Row> m_rows;
+	size_t m_rows_beginning;
+	size_t m_rows_width;
+	unsigned m_rows_generation;
 };
 
 }
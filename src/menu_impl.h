@@ -40,7 +40,10 @@ Menu<ItemT>::Menu(size_t startx,
 	m_highlight_color(m_base_color),
 	m_highlight_enabled(true),
 	m_cyclic_scroll_enabled(false),
-	m_autocenter_cursor(false)
+	m_autocenter_cursor(false),
+	m_rows_beginning(0),
+	m_rows_width(0),
+	m_rows_generation(0)
 {
 }
 
@@ -57,6 +60,9 @@ Menu<ItemT>::Menu(const Menu &rhs)
 , m_drawn_position(rhs.m_drawn_position)
 , m_selected_prefix(rhs.m_selected_prefix)
 , m_selected_suffix(rhs.m_selected_suffix)
+, m_rows_beginning(0)
+, m_rows_width(0)
+, m_rows_generation(0)
 {
 	// there is no way to properly fill m_filtered_options
 	// (if rhs is filtered), so we just don't do it.
@@ -78,6 +84,9 @@ Menu<ItemT>::Menu(Menu &&rhs)
 , m_drawn_position(rhs.m_drawn_position)
 , m_selected_prefix(std::move(rhs.m_selected_prefix))
 , m_selected_suffix(std::move(rhs.m_selected_suffix))
+, m_rows_beginning(0)
+, m_rows_width(0)
+, m_rows_generation(0)
 {
 }
 
@@ -96,6 +105,10 @@ Menu<ItemT> &Menu<ItemT>::operator=(Menu rhs)
 	std::swap(m_drawn_position, rhs.m_drawn_position);
 	std::swap(m_selected_prefix, rhs.m_selected_prefix);
 	std::swap(m_selected_suffix, rhs.m_selected_suffix);
+	std::swap(m_rows, rhs.m_rows);
+	std::swap(m_rows_beginning, rhs.m_rows_beginning);
+	std::swap(m_rows_width, rhs.m_rows_width);
+	std::swap(m_rows_generation, rhs.m_rows_generation);
 	return *this;
 }
 
@@ -180,6 +193,14 @@ void Menu<ItemT>::refresh()
 			scroll(Scroll::Down);
 	}
 
+	if (m_rows_width != m_width || m_rows_generation != generation())
+	{
+		m_rows.clear();
+		m_rows_width = m_width;
+		m_rows_generation = generation();
+	}
+	std::vector<Row> rows(m_height);
+
 	size_t line = 0;
 	const size_t end_ = m_beginning+m_height;
 	m_drawn_position = m_beginning;
@@ -197,6 +218,33 @@ void Menu<ItemT>::refresh()
 			mvwhline(m_window, line, 0, 0, m_width);
 			continue;
 		}
+
+		// if the item is in the same state as when it was last drawn,
+		// put the line back instead of running item displayer again.
+		bool is_highlighted = m_highlight_enabled && m_drawn_position == m_highlight;
+		size_t next_version = m_drawn_position+1 < m_items.size()
+		                    ? m_items[m_drawn_position+1].version()
+		                    : 0;
+		Row &row = rows[line];
+		size_t old_line = m_drawn_position-m_rows_beginning;
+		if (m_drawn_position >= m_rows_beginning && old_line < m_rows.size())
+		{
+			Row &old_row = m_rows[old_line];
+			if (old_row.position == m_drawn_position
+			&&  old_row.version == m_items[m_drawn_position].version()
+			&&  old_row.next_version == next_version
+			&&  old_row.is_highlighted == is_highlighted)
+			{
+				row = std::move(old_row);
+#				ifdef NCMPCPP_UNICODE
+				mvwadd_wchnstr(m_window, line, 0, row.cells.data(), -1);
+#				else
+				mvwaddchnstr(m_window, line, 0, row.cells.data(), -1);
+#				endif // NCMPCPP_UNICODE
+				continue;
+			}
+		}
+
 		if (m_items[m_drawn_position].isBold())
 			*this << Format::Bold;
 		if (m_highlight_enabled && m_drawn_position == m_highlight)
@@ -218,7 +266,21 @@ void Menu<ItemT>::refresh()
 		}
 		if (m_items[m_drawn_position].isBold())
 			*this << Format::NoBold;
+
+		row.position = m_drawn_position;
+		row.version = m_items[m_drawn_position].version();
+		row.next_version = next_version;
+		row.is_highlighted = is_highlighted;
+		row.cells.clear();
+		row.cells.resize(m_width+1);
+#		ifdef NCMPCPP_UNICODE
+		mvwin_wchnstr(m_window, line, 0, row.cells.data(), m_width);
+#		else
+		mvwinchnstr(m_window, line, 0, row.cells.data(), m_width);
+#		endif // NCMPCPP_UNICODE
 	}
+	m_rows = std::move(rows);
+	m_rows_beginning = m_beginning;
 	Window::refresh();
 }
 
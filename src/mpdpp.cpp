@@ -30,6 +30,10 @@ MPD::Connection Mpd;
 
 namespace {
 
+// MPD closes connections inactive for connection_timeout
+// seconds (60 by default), so stay well below that.
+const std::time_t keep_alive_interval = 30;
+
 const char *mpdDirectory(const std::string &directory)
 {
 	// MPD <= 0.19 accepts "/" for a root directory whereas later
@@ -56,6 +60,18 @@ defaultFetcher(SourceT *(fetcher)(mpd_connection *))
 	};
 }
 
+bool fetchDatabaseSong(MPD::SongIterator::State &state)
+{
+	auto src = mpd_recv_song(state.connection());
+	if (src != nullptr)
+	{
+		state.setObject(MPD::Song::intern(src));
+		return true;
+	}
+	else
+		return false;
+}
+
 bool fetchItemSong(MPD::SongIterator::State &state)
 {
 	auto src = mpd_recv_entity(state.connection());
@@ -66,7 +82,7 @@ bool fetchItemSong(MPD::SongIterator::State &state)
 	}
 	if (src != nullptr)
 	{
-		state.setObject(mpd_song_dup(mpd_entity_get_song(src)));
+		state.setObject(MPD::Song::intern(mpd_song_dup(mpd_entity_get_song(src))));
 		mpd_entity_free(src);
 		return true;
 	}
@@ -99,8 +115,10 @@ void checkConnectionErrors(mpd_connection *conn)
 }
 
 Connection::Connection() : m_connection(nullptr),
+				m_idle_connection(nullptr),
 				m_command_list_active(false),
 				m_idle(false),
+				m_dedicated_idle_connection(false),
 				m_host("localhost"),
 				m_port(6600),
 				m_timeout(15)
@@ -114,9 +132,15 @@ void Connection::Connect()
 	{
 		m_connection.reset(mpd_connection_new(m_host.c_str(), m_port, m_timeout * 1000));
 		checkErrors();
+		if (m_dedicated_idle_connection)
+		{
+			m_idle_connection.reset(mpd_connection_new(m_host.c_str(), m_port, m_timeout * 1000));
+			checkConnectionErrors(m_idle_connection.get());
+		}
 		if (!m_password.empty())
 			SendPassword();
-		m_fd = mpd_connection_get_fd(m_connection.get());
+		m_fd = mpd_connection_get_fd(idleConnection());
+		m_last_command = std::time(nullptr);
 		checkErrors();
 	}
 	catch (MPD::ClientError &e)
@@ -134,6 +158,7 @@ bool Connection::Connected() const
 void Connection::Disconnect()
 {
 	m_connection = nullptr;
+	m_idle_connection = nullptr;
 	m_command_list_active = false;
 	m_idle = false;
 }
@@ -162,6 +187,25 @@ void Connection::SendPassword()
 	assert(!m_command_list_active);
 	mpd_run_password(m_connection.get(), m_password.c_str());
 	checkErrors();
+	if (m_idle_connection)
+	{
+		mpd_run_password(m_idle_connection.get(), m_password.c_str());
+		checkConnectionErrors(m_idle_connection.get());
+	}
+}
+
+void Connection::KeepAlive()
+{
+	checkConnection();
+	if (m_idle_connection
+	&&  !m_command_list_active
+	&&  std::time(nullptr) - m_last_command >= keep_alive_interval)
+	{
+		prechecks();
+		mpd_send_command(m_connection.get(), "ping", nullptr);
+		mpd_response_finish(m_connection.get());
+		checkErrors();
+	}
 }
 
 void Connection::idle()
@@ -169,8 +213,8 @@ void Connection::idle()
 	checkConnection();
 	if (!m_idle)
 	{
-		mpd_send_idle(m_connection.get());
-		checkErrors();
+		mpd_send_idle(idleConnection());
+		checkConnectionErrors(idleConnection());
 	}
 	m_idle = true;
 }
@@ -179,12 +223,16 @@ int Connection::noidle()
 {
 	checkConnection();
 	int flags = 0;
-	if (m_idle && mpd_send_noidle(m_connection.get()))
+	mpd_connection *conn = idleConnection();
+	// if the idle connection is a dedicated one, this is called only when
+	// there is a pending event (or for sending password), so noidle will be
+	// ignored by MPD and we don't wait for an additional round trip.
+	if (m_idle && mpd_send_noidle(conn))
 	{
 		m_idle = false;
-		flags = mpd_recv_idle(m_connection.get(), true);
-		mpd_response_finish(m_connection.get());
-		checkErrors();
+		flags = mpd_recv_idle(conn, true);
+		mpd_response_finish(conn);
+		checkConnectionErrors(conn);
 	}
 	return flags;
 }
@@ -280,6 +328,18 @@ void Connection::Move(unsigned from, unsigned to)
 	}
 }
 
+void Connection::MoveRange(unsigned start, unsigned end, unsigned to)
+{
+	prechecks();
+	if (m_command_list_active)
+		mpd_send_move_range(m_connection.get(), start, end, to);
+	else
+	{
+		mpd_run_move_range(m_connection.get(), start, end, to);
+		checkErrors();
+	}
+}
+
 void Connection::Swap(unsigned from, unsigned to)
 {
 	prechecks();
@@ -364,10 +424,27 @@ void Connection::Rename(const std::string &from, const std::string &to)
 	checkErrors();
 }
 
-SongIterator Connection::GetPlaylistChanges(unsigned version)
+PositionIdIterator Connection::GetPlaylistChangesPosId(unsigned version)
 {
 	prechecksNoCommandsList();
-	mpd_send_queue_changes_meta(m_connection.get(), version);
+	mpd_send_queue_changes_brief(m_connection.get(), version);
+	checkErrors();
+	return PositionIdIterator(m_connection.get(), [](PositionIdIterator::State &state) {
+		unsigned pos, id;
+		if (mpd_recv_queue_change_brief(state.connection(), &pos, &id))
+		{
+			state.setObject(std::make_pair(pos, id));
+			return true;
+		}
+		else
+			return false;
+	});
+}
+
+SongIterator Connection::GetPlaylistRange(unsigned start, unsigned end)
+{
+	prechecksNoCommandsList();
+	mpd_send_list_queue_range_meta(m_connection.get(), start, end);
 	checkErrors();
 	return SongIterator(m_connection.get(), defaultFetcher<Song>(mpd_recv_song));
 }
@@ -400,7 +477,7 @@ SongIterator Connection::GetPlaylistContent(const std::string &path)
 {
 	prechecksNoCommandsList();
 	mpd_send_list_playlist_meta(m_connection.get(), path.c_str());
-	SongIterator result(m_connection.get(), defaultFetcher<Song>(mpd_recv_song));
+	SongIterator result(m_connection.get(), fetchDatabaseSong);
 	checkErrors();
 	return result;
 }
@@ -549,6 +626,66 @@ int Connection::AddSong(const Song &s, int pos)
 	return AddSong((!s.isFromDatabase() ? "file://" : "") + s.getURI(), pos);
 }
 
+std::vector<int> Connection::AddSongs(std::vector<Song>::const_iterator first,
+                                      std::vector<Song>::const_iterator last,
+                                      int position,
+                                      const ServerErrorHandler &error_handler)
+{
+	// Limit the size of a single command list so that
+	// it doesn't exceed max_command_list_size of MPD.
+	const ptrdiff_t batch_size = 1024;
+
+	prechecksNoCommandsList();
+	std::vector<int> result;
+	result.reserve(last-first);
+	int added = 0;
+	while (first != last)
+	{
+		auto batch_end = last-first > batch_size ? first+batch_size : last;
+		mpd_command_list_begin(m_connection.get(), true);
+		for (auto s = first; s != batch_end; ++s)
+		{
+			std::string path = (!s->isFromDatabase() ? "file://" : "") + s->getURI();
+			if (position < 0)
+				mpd_send_add_id(m_connection.get(), path.c_str());
+			else
+				mpd_send_add_id_to(m_connection.get(), path.c_str(), position+added+(s-first));
+		}
+		mpd_command_list_end(m_connection.get());
+		for (; first != batch_end; ++first)
+		{
+			int id = mpd_recv_song_id(m_connection.get());
+			if (id < 0)
+				break;
+			result.push_back(id);
+			++added;
+			mpd_response_next(m_connection.get());
+		}
+		mpd_response_finish(m_connection.get());
+		try
+		{
+			checkErrors();
+		}
+		catch (ServerError &e)
+		{
+			// MPD discards the rest of the command list after the
+			// failed command, so mark the song that caused the error
+			// and send remaining ones in the next iteration.
+			assert(first != batch_end);
+			result.push_back(-1);
+			++first;
+			if (error_handler)
+				error_handler(e);
+			else
+				throw;
+			continue;
+		}
+		if (first != batch_end)
+			throw ClientError(MPD_ERROR_MALFORMED, "Unexpected response to addid command", false);
+	}
+	return result;
+}
+
 void Connection::Add(const std::string &path)
 {
 	prechecks();
@@ -588,20 +725,9 @@ bool Connection::AddRandomTag(mpd_tag_type tag, size_t number)
 	return true;
 }
 
-bool Connection::AddRandomSongs(size_t number)
+bool Connection::AddRandomSongs(size_t number, const std::vector<Song> &songs)
 {
-	prechecksNoCommandsList();
-	std::vector<std::string> files;
-	mpd_send_list_all(m_connection.get(), "/");
-	while (mpd_pair *item = mpd_recv_pair_named(m_connection.get(), "file"))
-	{
-		files.push_back(item->value);
-		mpd_return_pair(m_connection.get(), item);
-	}
-	mpd_response_finish(m_connection.get());
-	checkErrors();
-	
-	if (number > files.size())
+	if (number > songs.size())
 	{
 		//if (itsErrorHandler)
 		//	itsErrorHandler(this, 0, "Requested number of random songs is bigger than size of your library", itsErrorHandlerUserdata);
@@ -609,11 +735,15 @@ bool Connection::AddRandomSongs(size_t number)
 	}
 	else
 	{
-		std::random_shuffle(files.begin(), files.end());
+		// shuffle only as many positions as we need
+		std::vector<size_t> positions(songs.size());
+		for (size_t i = 0; i < positions.size(); ++i)
+			positions[i] = i;
+		for (size_t i = 0; i < number; ++i)
+			std::swap(positions[i], positions[i+rand()%(positions.size()-i)]);
 		StartCommandsList();
-		auto it = files.begin();
-		for (size_t i = 0; i < number && it != files.end(); ++i, ++it)
-			AddSong(*it);
+		for (size_t i = 0; i < number; ++i)
+			AddSong(songs[positions[i]]);
 		CommitCommandsList();
 	}
 	return true;
@@ -738,12 +868,20 @@ void Connection::AddSearchURI(const std::string &str) const
 	mpd_search_add_uri_constraint(m_connection.get(), MPD_OPERATOR_DEFAULT, str.c_str());
 }
 
+#if LIBMPDCLIENT_CHECK_VERSION(2, 10, 0)
+void Connection::AddSearchModifiedSince(time_t mtime) const
+{
+	checkConnection();
+	mpd_search_add_modified_since_constraint(m_connection.get(), MPD_OPERATOR_DEFAULT, mtime);
+}
+#endif // LIBMPDCLIENT_CHECK_VERSION(2, 10, 0)
+
 SongIterator Connection::CommitSearchSongs()
 {
 	prechecksNoCommandsList();
 	mpd_search_commit(m_connection.get());
 	checkErrors();
-	return SongIterator(m_connection.get(), defaultFetcher<Song>(mpd_recv_song));
+	return SongIterator(m_connection.get(), fetchDatabaseSong);
 }
 
 ItemIterator Connection::GetDirectory(const std::string &directory)
@@ -762,6 +900,32 @@ SongIterator Connection::GetDirectoryRecursive(const std::string &directory)
 	return SongIterator(m_connection.get(), fetchItemSong);
 }
 
+ItemIterator Connection::GetDirectoryRecursiveItems(const std::string &directory)
+{
+	prechecksNoCommandsList();
+	mpd_send_list_all_meta(m_connection.get(), mpdDirectory(directory));
+	checkErrors();
+	return ItemIterator(m_connection.get(), defaultFetcher<Item>(mpd_recv_entity));
+}
+
+StringIterator Connection::GetDirectoryRecursiveUris(const std::string &directory)
+{
+	prechecksNoCommandsList();
+	mpd_send_list_all(m_connection.get(), mpdDirectory(directory));
+	checkErrors();
+	return StringIterator(m_connection.get(), [](StringIterator::State &state) {
+		auto src = mpd_recv_pair_named(state.connection(), "file");
+		if (src != nullptr)
+		{
+			state.setObject(src->value);
+			mpd_return_pair(state.connection(), src);
+			return true;
+		}
+		else
+			return false;
+	});
+}
+
 DirectoryIterator Connection::GetDirectories(const std::string &directory)
 {
 	prechecksNoCommandsList();
@@ -775,7 +939,7 @@ SongIterator Connection::GetSongs(const std::string &directory)
 	prechecksNoCommandsList();
 	mpd_send_list_meta(m_connection.get(), mpdDirectory(directory));
 	checkErrors();
-	return SongIterator(m_connection.get(), defaultFetcher<Song>(mpd_recv_song));
+	return SongIterator(m_connection.get(), fetchDatabaseSong);
 }
 
 OutputIterator Connection::GetOutputs()
@@ -846,7 +1010,11 @@ void Connection::checkConnection() const
 void Connection::prechecks()
 {
 	checkConnection();
-	noidle();
+	m_last_command = std::time(nullptr);
+	// dedicated idle connection doesn't need to be taken out of idle
+	// mode as commands are sent through the other one.
+	if (!m_idle_connection)
+		noidle();
 }
 
 void Connection::prechecksNoCommandsList()
@@ -860,4 +1028,9 @@ void Connection::checkErrors() const
 	checkConnectionErrors(m_connection.get());
 }
 
+mpd_connection *Connection::idleConnection() const
+{
+	return m_idle_connection ? m_idle_connection.get() : m_connection.get();
+}
+
 }
@@ -22,6 +22,7 @@
 #define NCMPCPP_MPDPP_H
 
 #include <cassert>
+#include <ctime>
 #include <exception>
 #include <set>
 #include <vector>
@@ -220,7 +221,7 @@ struct Item
 				break;
 			case MPD_ENTITY_TYPE_SONG:
 				m_type = Type::Song;
-				m_song = Song(mpd_song_dup(mpd_entity_get_song(entity)));
+				m_song = Song::intern(mpd_song_dup(mpd_entity_get_song(entity)));
 				break;
 			case MPD_ENTITY_TYPE_PLAYLIST:
 				m_type = Type::Playlist;
@@ -457,11 +458,14 @@ typedef Iterator<Directory> DirectoryIterator;
 typedef Iterator<Item> ItemIterator;
 typedef Iterator<Output> OutputIterator;
 typedef Iterator<Playlist> PlaylistIterator;
+typedef Iterator<std::pair<unsigned, unsigned>> PositionIdIterator;
 typedef Iterator<Song> SongIterator;
 typedef Iterator<std::string> StringIterator;
 
 struct Connection
 {
+	typedef std::function<void(ServerError &)> ServerErrorHandler;
+
 	Connection();
 	
 	void Connect();
@@ -473,14 +477,23 @@ struct Connection
 	
 	unsigned Version() const;
 	
+	/// @return descriptor of the connection that delivers idle events
 	int GetFD() const { return m_fd; }
+	/// @return descriptor of the connection commands are sent through
+	int GetCommandFD() const { return mpd_connection_get_fd(m_connection.get()); }
 	
 	void SetHostname(const std::string &);
 	void SetPort(int port) { m_port = port; }
 	void SetTimeout(int timeout) { m_timeout = timeout; }
+	void SetDedicatedIdleConnection(bool enabled) { m_dedicated_idle_connection = enabled; }
 	void SetPassword(const std::string &password) { m_password = password; }
 	void SendPassword();
 	
+	/// Pings the server through the command connection if it wasn't used
+	/// for a while, so that it isn't closed because of the server's timeout
+	/// (with dedicated idle connection it never enters idle mode).
+	void KeepAlive();
+	
 	Statistics getStatistics();
 	Status getStatus();
 	
@@ -495,13 +508,15 @@ struct Connection
 	void Next();
 	void Prev();
 	void Move(unsigned int from, unsigned int to);
+	void MoveRange(unsigned start, unsigned end, unsigned to);
 	void Swap(unsigned, unsigned);
 	void Seek(unsigned int pos, unsigned int where);
 	void Shuffle();
 	void ShuffleRange(unsigned start, unsigned end);
 	void ClearMainPlaylist();
 	
-	SongIterator GetPlaylistChanges(unsigned);
+	PositionIdIterator GetPlaylistChangesPosId(unsigned);
+	SongIterator GetPlaylistRange(unsigned start, unsigned end);
 	
 	Song GetCurrentSong();
 	Song GetSong(const std::string &);
@@ -524,8 +539,12 @@ struct Connection
 	
 	int AddSong(const std::string &, int = -1); // returns id of added song
 	int AddSong(const Song &, int = -1); // returns id of added song
+	std::vector<int> AddSongs(std::vector<Song>::const_iterator first,
+	                          std::vector<Song>::const_iterator last,
+	                          int position = -1,
+	                          const ServerErrorHandler &error_handler = nullptr);
 	bool AddRandomTag(mpd_tag_type, size_t);
-	bool AddRandomSongs(size_t);
+	bool AddRandomSongs(size_t number, const std::vector<Song> &songs);
 	void Add(const std::string &path);
 	void Delete(unsigned int pos);
 	void PlaylistDelete(const std::string &playlist, unsigned int pos);
@@ -546,12 +565,19 @@ struct Connection
 	void AddSearch(mpd_tag_type item, const std::string &str) const;
 	void AddSearchAny(const std::string &str) const;
 	void AddSearchURI(const std::string &str) const;
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 10, 0)
+	void AddSearchModifiedSince(time_t mtime) const;
+#	endif // LIBMPDCLIENT_CHECK_VERSION(2, 10, 0)
 	SongIterator CommitSearchSongs();
 	
 	PlaylistIterator GetPlaylists();
 	StringIterator GetList(mpd_tag_type type);
 	ItemIterator GetDirectory(const std::string &directory);
 	SongIterator GetDirectoryRecursive(const std::string &directory);
+	ItemIterator GetDirectoryRecursiveItems(const std::string &directory);
+	/// @return uris of songs in the directory and its subdirectories
+	/// without their metadata, which is much cheaper to transfer
+	StringIterator GetDirectoryRecursiveUris(const std::string &directory);
 	SongIterator GetSongs(const std::string &directory);
 	DirectoryIterator GetDirectories(const std::string &directory);
 	
@@ -577,11 +603,18 @@ private:
 	void prechecksNoCommandsList();
 	void checkErrors() const;
 
+	mpd_connection *idleConnection() const;
+
 	std::unique_ptr<mpd_connection, ConnectionDeleter> m_connection;
+	// if dedicated idle connection is enabled, this one stays in idle
+	// mode and m_connection is used exclusively for sending commands.
+	std::unique_ptr<mpd_connection, ConnectionDeleter> m_idle_connection;
 	bool m_command_list_active;
 	
 	int m_fd;
+	std::time_t m_last_command;
 	bool m_idle;
+	bool m_dedicated_idle_connection;
 	
 	std::string m_host;
 	int m_port;
@@ -24,6 +24,15 @@
 
 namespace MPD {
 
+const char *MutableSong::getTagValue(mpd_tag_type type, unsigned idx) const
+{
+	auto it = m_tags.find(Tag(type, idx));
+	if (it == m_tags.end())
+		return Song::getTagValue(type, idx);
+	else
+		return it->second.c_str();
+}
+
 std::string MutableSong::getArtist(unsigned idx) const
 {
 	return getTag(MPD_TAG_ARTIST, [this, idx](){ return Song::getArtist(idx); }, idx);
@@ -34,6 +34,8 @@ struct MutableSong : public Song
 	MutableSong() : m_mtime(0), m_duration(0) { }
 	MutableSong(Song s) : Song(s), m_mtime(0), m_duration(0) { }
 	
+	virtual const char *getTagValue(mpd_tag_type type, unsigned idx = 0) const OVERRIDE;
+
 	virtual std::string getArtist(unsigned idx = 0) const OVERRIDE;
 	virtual std::string getTitle(unsigned idx = 0) const OVERRIDE;
 	virtual std::string getAlbum(unsigned idx = 0) const OVERRIDE;
@@ -54,6 +54,7 @@ Playlist::Playlist()
 : m_total_length(0), m_remaining_time(0), m_scroll_begin(0)
 , m_timer(boost::posix_time::from_time_t(0))
 , m_reload_total_length(false), m_reload_remaining(false)
+, m_search_index_display_mode(Config.playlist_display_mode)
 {
 	w = NC::Menu<MPD::Song>(0, MainStartY, COLS, MainHeight, Config.playlist_display_mode == DisplayMode::Columns && Config.titles_visibility ? Display::Columns(COLS) : "", Config.main_color, NC::Border());
 	w.cyclicScrolling(Config.use_cyclic_scrolling);
@@ -158,16 +159,33 @@ void Playlist::setSearchConstraint(const std::string &constraint)
 	m_search_predicate = Regex::Filter<MPD::Song>(
 		Regex::make(constraint, Config.regex_type), playlistEntryMatcher
 	);
+	RegexSyntax syntax;
+	if (Config.regex_type & boost::regex::literal)
+		syntax = RegexSyntax::Literal;
+	else if (Config.regex_type & boost::regex::basic_syntax_group)
+		syntax = RegexSyntax::Basic;
+	else
+		syntax = RegexSyntax::Extended;
+	m_search_literals = requiredLiterals(constraint, syntax, Config.regex_type & boost::regex::icase);
 }
 
 void Playlist::clearConstraint()
 {
 	m_search_predicate.clear();
+	m_search_literals.clear();
 }
 
 bool Playlist::find(SearchDirection direction, bool wrap, bool skip_current)
 {
-	return search(w, m_search_predicate, direction, wrap, skip_current);
+	if (m_search_predicate.defined() && !m_search_literals.empty())
+	{
+		updateSearchIndex();
+		return search(w, m_search_predicate, m_search_index.candidates(m_search_literals),
+			direction, wrap, skip_current
+		);
+	}
+	else
+		return search(w, m_search_predicate, direction, wrap, skip_current);
 }
 
 /***********************************************************************/
@@ -213,18 +231,29 @@ std::string Playlist::getTotalLength()
 {
 	std::ostringstream result;
 	
+	// songs removed from the end of the playlist are dropped here,
+	// but anything else that's out of sync is computed from scratch.
+	if (m_durations.size() > w.size())
+		m_durations.resize(w.size());
+	else if (m_durations.size() < w.size())
+	{
+		m_durations.resize(w.size());
+		for (size_t i = 0; i < w.size(); ++i)
+			m_durations.set(i, w[i].value().getDuration());
+	}
+
 	if (m_reload_total_length)
 	{
-		m_total_length = 0;
-		for (const auto &s : w)
-			m_total_length += s.value().getDuration();
+		m_total_length = m_durations.sum();
 		m_reload_total_length = false;
 	}
 	if (Config.playlist_show_remaining_time && m_reload_remaining)
 	{
-		m_remaining_time = 0;
-		for (size_t i = Status::State::currentSongPosition(); i < w.size(); ++i)
-			m_remaining_time += w[i].value().getDuration();
+		size_t position = Status::State::currentSongPosition();
+		if (position < w.size())
+			m_remaining_time = m_durations.sum() - m_durations.prefixSum(position);
+		else
+			m_remaining_time = 0;
 		m_reload_remaining = false;
 	}
 	
@@ -254,6 +283,36 @@ void Playlist::setSelectedItemsPriority(int prio)
 	Statusbar::print("Priority set");
 }
 
+void Playlist::updateSearchIndex()
+{
+	// songs with updated tags (e.g. streams with a new title) are replaced
+	// with new objects that compare equal, so compare their data instead.
+	bool up_to_date = m_search_index.size() == w.size()
+	               && m_search_index_display_mode == Config.playlist_display_mode;
+	for (size_t i = 0; up_to_date && i < w.size(); ++i)
+		up_to_date = w[i].value().sharesDataWith(m_search_index_songs[i]);
+	if (!up_to_date)
+	{
+		m_search_index.clear();
+		m_search_index_songs.clear();
+		m_search_index_songs.reserve(w.size());
+		for (const auto &s : w)
+		{
+			m_search_index.add(songToString(s.value()));
+			m_search_index_songs.push_back(s.value());
+		}
+		m_search_index_display_mode = Config.playlist_display_mode;
+	}
+}
+
+void Playlist::songChanged(size_t pos)
+{
+	assert(pos < w.size());
+	if (m_durations.size() != w.size())
+		m_durations.resize(w.size());
+	m_durations.set(pos, w[pos].value().getDuration());
+}
+
 bool Playlist::checkForSong(const MPD::Song &s)
 {
 	return m_song_refs.find(s) != m_song_refs.end();
@@ -261,7 +320,8 @@ bool Playlist::checkForSong(const MPD::Song &s)
 
 void Playlist::registerSong(const MPD::Song &s)
 {
-	++m_song_refs[s];
+	if (++m_song_refs[s] == 1)
+		m_changed_songs.insert(s);
 }
 
 void Playlist::unregisterSong(const MPD::Song &s)
@@ -269,11 +329,21 @@ void Playlist::unregisterSong(const MPD::Song &s)
 	auto it = m_song_refs.find(s);
 	assert(it != m_song_refs.end());
 	if (it->second == 1)
+	{
+		m_changed_songs.insert(s);
 		m_song_refs.erase(it);
+	}
 	else
 		--it->second;
 }
 
+std::vector<MPD::Song> Playlist::takeChangedSongs()
+{
+	std::vector<MPD::Song> result(m_changed_songs.begin(), m_changed_songs.end());
+	m_changed_songs.clear();
+	return result;
+}
+
 namespace {
 
 std::string songToString(const MPD::Song &s)
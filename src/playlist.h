@@ -23,12 +23,15 @@
 
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "interfaces.h"
 #include "regex_filter.h"
 #include "screen.h"
 #include "song.h"
 #include "song_list.h"
+#include "utility/fenwick_tree.h"
+#include "utility/trigram_index.h"
 
 struct Playlist: Screen<SongMenu>, HasSongs, Searchable, Tabbable
 {
@@ -69,18 +72,31 @@ struct Playlist: Screen<SongMenu>, HasSongs, Searchable, Tabbable
 	bool checkForSong(const MPD::Song &s);
 	void registerSong(const MPD::Song &s);
 	void unregisterSong(const MPD::Song &s);
+
+	/// @return songs that were added to or removed from the playlist
+	/// since the last call (not ones whose number of occurrences changed).
+	std::vector<MPD::Song> takeChangedSongs();
 	
+	/// Needs to be called after a song at given position was added or
+	/// replaced, so that durations of songs in the playlist are up to date.
+	void songChanged(size_t pos);
+
 	void reloadTotalLength() { m_reload_total_length = true; }
 	void reloadRemaining() { m_reload_remaining = true; }
 	
 private:
 	std::string getTotalLength();
+	void updateSearchIndex();
 
 	std::string m_stats;
 	
 	std::unordered_map<MPD::Song, int, MPD::Song::Hash> m_song_refs;
+	std::unordered_set<MPD::Song, MPD::Song::Hash> m_changed_songs;
 	
-	size_t m_total_length;;
+	// durations of songs in the playlist
+	FenwickTree<size_t> m_durations;
+
+	size_t m_total_length;
 	size_t m_remaining_time;
 	size_t m_scroll_begin;
 	
@@ -90,6 +106,13 @@ private:
 	bool m_reload_remaining;
 
 	Regex::Filter<MPD::Song> m_search_predicate;
+	std::vector<std::string> m_search_literals;
+
+	// trigrams of string representations of songs
+	// used for narrowing down the set of searched songs.
+	TrigramIndex m_search_index;
+	std::vector<MPD::Song> m_search_index_songs;
+	DisplayMode m_search_index_display_mode;
 };
 
 extern Playlist *myPlaylist;
@@ -54,7 +54,6 @@ size_t LeftColumnWidth;
 size_t RightColumnStartX;
 size_t RightColumnWidth;
 
-std::string SongToString(const MPD::Song &s);
 bool PlaylistEntryMatcher(const Regex::Regex &rx, const MPD::Playlist &playlist);
 bool SongEntryMatcher(const Regex::Regex &rx, const MPD::Song &s);
 
@@ -156,8 +155,9 @@ void PlaylistEditor::update()
 		};
 		if (idx < Playlists.size())
 			Playlists.resizeList(idx);
-		std::sort(Playlists.beginV(), Playlists.endV(),
-			LocaleBasedSorting(std::locale(), Config.ignore_leading_the));
+		LocaleBasedSorting(std::locale(), Config.ignore_leading_the).sort(
+			Playlists.beginV(), Playlists.endV()
+		);
 		Playlists.refresh();
 	}
 	
@@ -173,22 +173,14 @@ void PlaylistEditor::update()
 			MPD::SongIterator s = Mpd.GetPlaylistContent(Playlists.current()->value().path()), end;
 			for (; s != end; ++s, ++idx)
 			{
-				bool in_playlist = myPlaylist->checkForSong(*s);
 				if (idx < Content.size())
-				{
-					Content[idx].setBold(in_playlist);
 					Content[idx].value() = std::move(*s);
-				}
 				else
-				{
-					auto properties = NC::List::Properties::Selectable;
-					if (in_playlist)
-						properties |= NC::List::Properties::Bold;
-					Content.addItem(std::move(*s), properties);
-				}
+					Content.addItem(std::move(*s));
 			}
 			if (idx < Content.size())
 				Content.resizeList(idx);
+			markSongsInPlaylist(Content);
 			std::string wtitle;
 			if (Config.titles_visibility)
 			{
@@ -438,29 +430,25 @@ void PlaylistEditor::Locate(const MPD::Playlist &playlist)
 
 namespace {
 
-std::string SongToString(const MPD::Song &s)
+bool PlaylistEntryMatcher(const Regex::Regex &rx, const MPD::Playlist &playlist)
 {
-	std::string result;
+	return Regex::search(playlist.path(), rx);
+}
+
+bool SongEntryMatcher(const Regex::Regex &rx, const MPD::Song &s)
+{
+	static thread_local std::string song_string;
+	song_string.clear();
 	switch (Config.playlist_display_mode)
 	{
 		case DisplayMode::Classic:
-			result = Format::stringify<char>(Config.song_list_format, &s);
+			Format::stringify<char>(Config.song_list_format, &s, song_string);
 			break;
 		case DisplayMode::Columns:
-			result = Format::stringify<char>(Config.song_columns_mode_format, &s);
+			Format::stringify<char>(Config.song_columns_mode_format, &s, song_string);
 			break;
 	}
-	return result;
-}
-
-bool PlaylistEntryMatcher(const Regex::Regex &rx, const MPD::Playlist &playlist)
-{
-	return Regex::search(playlist.path(), rx);
-}
-
-bool SongEntryMatcher(const Regex::Regex &rx, const MPD::Song &s)
-{
-	return Regex::search(SongToString(s), rx);
+	return Regex::search(song_string, rx);
 }
 
 }
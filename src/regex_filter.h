@@ -118,7 +118,7 @@ template <typename T> struct ItemFilter
 		m_filter = nullptr;
 	}
 
-	bool operator()(const Item &item) {
+	bool operator()(const Item &item) const {
 		return m_filter(m_rx, item);
 	}
 	
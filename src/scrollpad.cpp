@@ -20,6 +20,8 @@
 
 #include <cassert>
 #include <boost/regex.hpp>
+#include <cwchar>
+#include <cwctype>
 #include <iostream>
 
 #include "scrollpad.h"
@@ -58,6 +60,9 @@ const std::string &title,
 Color color,
 Border border)
 : Window(startx, starty, width, height, title, color, border),
+m_text_changed(false),
+m_layout_width(-1),
+m_layout_height(0),
 m_beginning(0),
 m_real_height(height)
 {
@@ -126,6 +131,7 @@ void Scrollpad::clear()
 {
 	m_real_height = m_height;
 	m_buffer.clear();
+	m_text_changed = true;
 	werase(m_window);
 	delwin(m_window);
 	m_window = newpad(m_height, m_width);
@@ -140,132 +146,56 @@ const std::string &Scrollpad::buffer()
 
 void Scrollpad::flush()
 {
+	if (m_text_changed)
+	{
+		splitIntoCharacters();
+		m_text_changed = false;
+		m_layout_width = -1;
+	}
+	if (m_layout_width != m_width)
+		computeLayout();
+
+	m_real_height = std::max(m_layout_height, m_height);
+	if (m_real_height > m_height)
+		recreate(m_width, m_real_height);
+	else
+		werase(m_window);
+
 	auto &w = static_cast<Window &>(*this);
 	const auto &s = m_buffer.str();
 	const auto &ps = m_buffer.properties();
 	auto p = ps.begin();
-	size_t i = 0;
-	
-	auto load_properties = [&]() {
-		for (; p != ps.end() && p->first == i; ++p)
-			w << p->second;
-	};
-	auto write_whitespace = [&]() {
-		for (; i < s.length() && iswspace(s[i]); ++i)
-		{
-			load_properties();
-			w << s[i];
-		}
+	auto write_run = [&](size_t begin, size_t end) {
+		if (begin < end)
+			waddnstr(m_window, s.c_str() + begin, end - begin);
 	};
-	auto write_word = [&](bool load_properties_) {
-		for (; i < s.length() && !iswspace(s[i]); ++i)
-		{
-			if (load_properties_)
-				load_properties();
-			w << s[i];
-		}
-	};
-	auto write_buffer = [&](bool generate_height_only) -> size_t {
-		int new_y;
-		size_t height = 1;
-		size_t old_i;
-		auto old_p = p;
-		int x, y;
-		i = 0;
-		p = ps.begin();
-		y = getY();
-		while (i < s.length())
+	for (const auto &segment : m_segments)
+	{
+		goToXY(segment.x, segment.y);
+		// write characters in runs that end where properties change
+		size_t run_begin = m_characters[segment.first].position;
+		for (size_t i = segment.first; i < segment.last; ++i)
 		{
-			// write all whitespaces.
-			write_whitespace();
-			
-			// if we are generating height, check difference
-			// between previous Y coord and current one and
-			// update height accordingly.
-			if (generate_height_only)
-			{
-				new_y = getY();
-				height += new_y - y;
-				y = new_y;
-			}
-			
-			if (i == s.length())
-				break;
-			
-			// save current string position state and get current
-			// coordinates as we are before the beginning of a word.
-			old_i = i;
-			old_p = p;
-			x = getX();
-			y = getY();
-			
-			// write word to test if it overflows, but do not load properties
-			// yet since if it overflows, we do not want to load them twice.
-			write_word(false);
-			
-			// restore previous indexes state
-			i = old_i;
-			p = old_p;
-			
-			// get new Y coord to see if word overflew into next line.
-			new_y = getY();
-			if (new_y != y)
-			{
-				if (generate_height_only)
-				{
-					// if it did, let's update height...
-					++height;
-				}
-				else
-				{
-					// ...or go to old coordinates, erase
-					// part of the string from previous line...
-					goToXY(x, y);
-					wclrtoeol(m_window);
-				}
-				
-				// ...start at the beginning of next line...
-				++y;
-				goToXY(0, y);
-				
-				// ...write word again, this time with properties...
-				write_word(true);
-				
-				if (generate_height_only)
-				{
-					// ... and check for potential
-					// difference in Y coordinates again.
-					new_y = getY();
-					height += new_y - y;
-				}
-			}
-			else
-			{
-				// word didn't overflow, rewrite it with properties.
-				goToXY(x, y);
-				write_word(true);
-			}
-			
-			if (generate_height_only)
+			const auto &c = m_characters[i];
+			if (p != ps.end() && p->first < c.position + c.length)
 			{
-				// move to the first line, since when we do
-				// generation, m_real_height = m_height and we
-				// don't have many lines to use.
-				goToXY(getX(), 0);
-				y = 0;
+				write_run(run_begin, c.position);
+				for (; p != ps.end() && p->first < c.position + c.length; ++p)
+					w << p->second;
+				run_begin = c.position;
 			}
 		}
-		// load remaining properties if there are any
-		for (; p != ps.end(); ++p)
-			w << p->second;
-		return height;
-	};
-	m_real_height = std::max(write_buffer(true), m_height);
-	if (m_real_height > m_height)
-		recreate(m_width, m_real_height);
-	else
-		werase(m_window);
-	write_buffer(false);
+		if (segment.spaces > 0)
+			w << std::string(segment.spaces, ' ');
+		else
+		{
+			const auto &c = m_characters[segment.last-1];
+			write_run(run_begin, c.position + c.length);
+		}
+	}
+	// load remaining properties if there are any
+	for (; p != ps.end(); ++p)
+		w << p->second;
 }
 
 void Scrollpad::reset()
@@ -288,4 +218,157 @@ void Scrollpad::removeProperties(size_t id)
 	m_buffer.removeProperties(id);
 }
 
+void Scrollpad::splitIntoCharacters()
+{
+	const auto &s = m_buffer.str();
+	m_characters.clear();
+	m_characters.reserve(s.length());
+#	ifdef NCMPCPP_UNICODE
+	std::mbstate_t state = std::mbstate_t();
+#	endif // NCMPCPP_UNICODE
+	for (size_t i = 0; i < s.length();)
+	{
+		Character c;
+		c.position = i;
+		wchar_t wc;
+#		ifdef NCMPCPP_UNICODE
+		c.length = std::mbrtowc(&wc, s.c_str() + i, s.length() - i, &state);
+		if (c.length == size_t(-1) || c.length == size_t(-2))
+		{
+			// invalid sequence, treat its first byte as a character
+			state = std::mbstate_t();
+			wc = static_cast<unsigned char>(s[i]);
+			c.length = 1;
+		}
+		else if (c.length == 0)
+			c.length = 1;
+		c.width = wcwidth(wc);
+#		else
+		wc = static_cast<unsigned char>(s[i]);
+		c.length = 1;
+		c.width = isprint(wc) ? 1 : -1;
+#		endif // NCMPCPP_UNICODE
+		// control characters are displayed as ^X
+		if (c.width < 0)
+			c.width = 2;
+		switch (wc)
+		{
+			case '\t':
+				c.type = Character::Type::Tab;
+				break;
+			case '\n':
+				c.type = Character::Type::Newline;
+				break;
+			case '\r':
+				c.type = Character::Type::CarriageReturn;
+				break;
+			default:
+				c.type = iswspace(wc) ? Character::Type::Space : Character::Type::Word;
+		}
+		m_characters.push_back(c);
+		i += c.length;
+	}
+}
+
+void Scrollpad::computeLayout()
+{
+	m_layout_width = m_width;
+	m_segments.clear();
+
+	// characters are placed the same way curses places them
+	// when they are written one by one, with the exception
+	// that words which don't fit into the line are moved
+	// to the next one as a whole.
+	size_t x = 0, y = 0;
+	size_t segment_end = 0;
+	auto advance = [this](size_t &x_, size_t &y_, size_t width) {
+		if (x_ + width > m_width)
+		{
+			x_ = 0;
+			++y_;
+		}
+		x_ += width;
+		if (x_ >= m_width)
+		{
+			x_ = 0;
+			++y_;
+		}
+	};
+	auto place = [&](size_t i) {
+		const auto &c = m_characters[i];
+		switch (c.type)
+		{
+			case Character::Type::Newline:
+				x = 0;
+				++y;
+				break;
+			case Character::Type::CarriageReturn:
+				x = 0;
+				break;
+			case Character::Type::Tab:
+			{
+				size_t tab_stop = x + 8 - x%8;
+				if (tab_stop < m_width)
+				{
+					m_segments.push_back(Segment{i, i+1, x, y, tab_stop - x});
+					x = tab_stop;
+				}
+				else
+				{
+					x = 0;
+					++y;
+				}
+				break;
+			}
+			default:
+			{
+				// wide character that doesn't fit is moved to the next
+				// line and the rest of the current one is filled with
+				// spaces that have its attributes.
+				if (x + c.width > m_width)
+				{
+					if (x > 0)
+						m_segments.push_back(Segment{i, i+1, x, y, m_width - x});
+					x = 0;
+					++y;
+				}
+				// extend the last segment if the character directly follows it
+				auto last = m_segments.empty() ? nullptr : &m_segments.back();
+				if (last != nullptr && last->spaces == 0 && last->last == i
+				&&  last->y == y && segment_end == x)
+					++last->last;
+				else
+					m_segments.push_back(Segment{i, i+1, x, y, 0});
+				segment_end = x + c.width;
+				advance(x, y, c.width);
+				break;
+			}
+		}
+	};
+
+	for (size_t i = 0; i < m_characters.size();)
+	{
+		if (m_characters[i].type != Character::Type::Word)
+		{
+			place(i);
+			++i;
+			continue;
+		}
+		size_t end = i;
+		size_t word_x = x, word_y = y;
+		for (; end < m_characters.size() && m_characters[end].type == Character::Type::Word; ++end)
+			advance(word_x, word_y, m_characters[end].width);
+		// if the word doesn't fit into the current line,
+		// start it at the beginning of the next one.
+		if (word_y != y)
+		{
+			x = 0;
+			++y;
+		}
+		for (; i < end; ++i)
+			place(i);
+	}
+	m_layout_height = y+1;
+}
+
 }
@@ -21,6 +21,7 @@
 #ifndef NCMPCPP_SCROLLPAD_H
 #define NCMPCPP_SCROLLPAD_H
 
+#include <vector>
 #include "window.h"
 #include "strbuffer.h"
 
@@ -30,7 +31,7 @@ namespace NC {
 /// supports scrolling if the amount of it is bigger than the window area.
 struct Scrollpad: public Window
 {
-	Scrollpad() { }
+	Scrollpad() : m_text_changed(false), m_layout_width(-1), m_layout_height(0) { }
 	
 	Scrollpad(size_t startx, size_t starty, size_t width, size_t height,
 	          const std::string &title, Color color, Border border);
@@ -54,12 +55,47 @@ struct Scrollpad: public Window
 	Scrollpad &operator<<(const ItemT &item)
 	{
 		m_buffer << item;
+		m_text_changed = true;
 		return *this;
 	}
 	
 private:
+	/// Character of the buffer, stored as a range of bytes.
+	struct Character
+	{
+		enum class Type { Word, Space, Tab, Newline, CarriageReturn };
+
+		size_t position;
+		size_t length;
+		int width;
+		Type type;
+	};
+
+	/// Characters placed next to each other in one line. If spaces is not
+	/// zero, the segment is a tab or a gap left by a wide character moved
+	/// to the next line and it's filled with that many spaces instead.
+	struct Segment
+	{
+		size_t first;
+		size_t last;
+		size_t x;
+		size_t y;
+		size_t spaces;
+	};
+
+	void splitIntoCharacters();
+	void computeLayout();
+
 	Buffer m_buffer;
 	
+	// text split into characters doesn't depend on the width, so only
+	// placement of the characters is recomputed when it changes.
+	bool m_text_changed;
+	std::vector<Character> m_characters;
+	std::vector<Segment> m_segments;
+	size_t m_layout_width;
+	size_t m_layout_height;
+
 	size_t m_beginning;
 	size_t m_real_height;
 };
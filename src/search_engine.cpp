@@ -18,10 +18,12 @@
  *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
  ***************************************************************************/
 
+#include <algorithm>
 #include <array>
 #include <boost/range/detail/any_iterator.hpp>
 #include <iomanip>
 
+#include "database.h"
 #include "display.h"
 #include "global.h"
 #include "helpers.h"
@@ -449,6 +451,38 @@ void SearchEngine::Search()
 		}
 	}
 
+	// database songs are verified once, so that the index
+	// and iterated songs are guaranteed to correspond.
+	static const std::vector<MPD::Song> no_songs;
+	const auto &db_songs = Config.search_in_db ? Database::songs() : no_songs;
+
+	// narrow down the set of songs regular expressions
+	// need to be matched against using the song index.
+	boost::optional<SongIndex::PostingList> candidates;
+	if (Config.search_in_db && SearchMode != &SearchModes[2])
+	{
+		bool icase = Config.regex_type & boost::regex::icase;
+		const auto &index = Database::index();
+		for (size_t i = 0; i < ConstraintsNumber; ++i)
+		{
+			if (rx[i].empty())
+				continue;
+			auto field = i == 0 ? nullptr : SongIndex::Fields[i-1];
+			auto songs = index.candidates(field, itsConstraints[i], icase);
+			if (!songs)
+				continue;
+			if (candidates)
+			{
+				SongIndex::PostingList common;
+				std::set_intersection(candidates->begin(), candidates->end(),
+					songs->begin(), songs->end(), std::back_inserter(common));
+				*candidates = std::move(common);
+			}
+			else
+				candidates = std::move(songs);
+		}
+	}
+
 	typedef boost::range_detail::any_iterator<
 		const MPD::Song,
 		boost::single_pass_traversal_tag,
@@ -458,8 +492,8 @@ void SearchEngine::Search()
 	input_song_iterator s, end;
 	if (Config.search_in_db)
 	{
-		s = input_song_iterator(getDatabaseIterator(Mpd));
-		end = input_song_iterator(MPD::SongIterator());
+		s = input_song_iterator(db_songs.begin());
+		end = input_song_iterator(db_songs.end());
 	}
 	else
 	{
@@ -468,8 +502,7 @@ void SearchEngine::Search()
 	}
 
 	LocaleStringComparison cmp(std::locale(), Config.ignore_leading_the);
-	for (; s != end; ++s)
-	{
+	auto matches = [&](const MPD::Song *s) -> bool {
 		bool any_found = true, found = true;
 
 		if (SearchMode != &SearchModes[2]) // match to pattern
@@ -544,9 +577,34 @@ void SearchEngine::Search()
 				found = !cmp(s->getComment(), itsConstraints[10]);
 		}
 		
-		if (any_found && found)
-			w.addItem(*s);
+		return any_found && found;
+	};
+
+	std::vector<const MPD::Song *> songs;
+	if (candidates)
+	{
+		songs.reserve(candidates->size());
+		for (auto id : *candidates)
+			songs.push_back(&db_songs[id]);
 	}
+	else
+	{
+		for (; s != end; ++s)
+			songs.push_back(&*s);
+	}
+
+	// regular expressions and comparison are safe to use
+	// concurrently, so songs can be matched in parallel.
+	const size_t part_size = 1024;
+	std::vector<char> matched(songs.size());
+	ThreadPool::instance().run((songs.size()+part_size-1)/part_size, [&](size_t part) {
+		size_t part_end = std::min(songs.size(), (part+1)*part_size);
+		for (size_t i = part*part_size; i < part_end; ++i)
+			matched[i] = matches(songs[i]);
+	});
+	for (size_t i = 0; i < songs.size(); ++i)
+		if (matched[i])
+			w.addItem(*songs[i]);
 }
 
 namespace {
@@ -247,8 +247,9 @@ void SelectedItemsAdder::populatePlaylistSelector(BaseScreen *old_screen)
 				std::bind(&Self::addToExistingPlaylist, this, it->path())
 			));
 		};
-		std::sort(m_playlist_selector.beginV()+begin, m_playlist_selector.endV(),
-			LocaleBasedSorting(std::locale(), Config.ignore_leading_the));
+		LocaleBasedSorting(std::locale(), Config.ignore_leading_the).sort(
+			m_playlist_selector.beginV()+begin, m_playlist_selector.endV()
+		);
 		if (begin < m_playlist_selector.size())
 			m_playlist_selector.addSeparator();
 	}
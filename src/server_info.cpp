@@ -109,6 +109,13 @@ void ServerInfo::update()
 	w << '\n';
 	w << NC::Format::Bold << "Last DB update: " << NC::Format::NoBold << Timestamp(stats.dbUpdateTime()) << '\n';
 	w << '\n';
+	auto cache_stats = Format::cacheStatistics();
+	if (cache_stats.first + cache_stats.second > 0)
+	{
+		w << NC::Format::Bold << "Formatted songs cache hit rate: " << NC::Format::NoBold
+		  << cache_stats.first*100 / (cache_stats.first + cache_stats.second) << "%\n";
+		w << '\n';
+	}
 	w << NC::Format::Bold << "URL Handlers:" << NC::Format::NoBold;
 	for (auto it = m_url_handlers.begin(); it != m_url_handlers.end(); ++it)
 		w << (it != m_url_handlers.begin() ? ", " : " ") << *it;
@@ -234,6 +234,9 @@ bool Configuration::read(const std::vector<std::string> &config_paths, bool igno
 	p.add("mpd_connection_timeout", assign_default(
 		mpd_connection_timeout, 5
 	));
+	p.add("mpd_dedicated_idle_connection", yes_no(
+		mpd_dedicated_idle_connection, false
+	));
 	p.add("mpd_crossfade_time", assign_default(
 		crossfade_time, 5
 	));
@@ -699,6 +702,9 @@ bool Configuration::read(const std::vector<std::string> &config_paths, bool igno
 		active_window_border, NC::Color::Red
 	));
 
+	// songs formatted with previous formats are no longer valid
+	Format::clearCache();
+
 	return std::all_of(
 		config_paths.begin(),
 		config_paths.end(),
@@ -123,6 +123,7 @@ struct Configuration
 
 	mpd_tag_type media_lib_primary_tag;
 
+	bool mpd_dedicated_idle_connection;
 	bool colors_enabled;
 	bool playlist_show_mpd_host;
 	bool playlist_show_remaining_time;
@@ -19,12 +19,15 @@
  ***************************************************************************/
 
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <boost/format.hpp>
-#include <boost/functional/hash.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 #include <iostream>
 #include <memory>
+#include <unordered_map>
 
 #include "song.h"
 #include "utility/type_conversions.h"
@@ -33,11 +36,73 @@
 
 namespace {
 
-size_t calc_hash(const char *s, size_t seed = 0)
+uint64_t load64(const char *s)
 {
-	for (; *s != '\0'; ++s)
-		boost::hash_combine(seed, *s);
-	return seed;
+	uint64_t result;
+	memcpy(&result, s, sizeof(result));
+	return result;
+}
+
+// Processes 8 bytes at a time and mixes each word with multiplications
+// and shifts, so that common prefixes of paths don't cause collisions.
+size_t calc_hash(const char *s, size_t length)
+{
+	const uint64_t m1 = 0x9e3779b97f4a7c15ULL;
+	const uint64_t m2 = 0xff51afd7ed558ccdULL;
+	uint64_t hash = length * m1;
+	size_t i = 0;
+	for (; i+8 <= length; i += 8)
+	{
+		uint64_t word = load64(s+i) * m2;
+		word ^= word >> 32;
+		hash = (hash ^ word) * m1;
+		hash ^= hash >> 29;
+	}
+	uint64_t tail = 0;
+	memcpy(&tail, s+i, length-i);
+	hash = (hash ^ (tail * m2)) * m1;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+// songs returned by Song::intern, indexed by hashes of their uris
+std::unordered_multimap<size_t, std::weak_ptr<mpd_song>> interned_songs;
+// size of interned_songs that triggers removal of expired entries
+size_t interned_songs_sweep_size = 1024;
+boost::mutex interned_songs_mutex;
+
+bool sameTags(const mpd_song *a, const mpd_song *b)
+{
+	for (int type = 0; type < MPD_TAG_COUNT; ++type)
+	{
+		auto tag_type = static_cast<mpd_tag_type>(type);
+		for (unsigned idx = 0;; ++idx)
+		{
+			const char *tag_a = mpd_song_get_tag(a, tag_type, idx);
+			const char *tag_b = mpd_song_get_tag(b, tag_type, idx);
+			if (tag_a == nullptr || tag_b == nullptr)
+			{
+				if (tag_a != tag_b)
+					return false;
+				break;
+			}
+			if (strcmp(tag_a, tag_b) != 0)
+				return false;
+		}
+	}
+	return true;
+}
+
+// Tags are compared as well since they can change without modification
+// time being updated, e.g. after rescan or for streams changing title.
+bool sameSong(const mpd_song *a, const mpd_song *b)
+{
+	return mpd_song_get_last_modified(a) == mpd_song_get_last_modified(b)
+	    && mpd_song_get_duration(a) == mpd_song_get_duration(b)
+	    && mpd_song_get_pos(a) == mpd_song_get_pos(b)
+	    && mpd_song_get_id(a) == mpd_song_get_id(b)
+	    && strcmp(mpd_song_get_uri(a), mpd_song_get_uri(b)) == 0
+	    && sameTags(a, b);
 }
 
 }
@@ -55,11 +120,19 @@ std::string Song::get(mpd_tag_type type, unsigned idx) const
 	return result;
 }
 
+const char *Song::getTagValue(mpd_tag_type type, unsigned idx) const
+{
+	assert(m_song);
+	return mpd_song_get_tag(m_song.get(), type, idx);
+}
+
 Song::Song(mpd_song *s)
 {
 	assert(s);
 	m_song = std::shared_ptr<mpd_song>(s, mpd_song_free);
-	m_hash = calc_hash(mpd_song_get_uri(s));
+	const char *uri = mpd_song_get_uri(s);
+	m_uri_length = strlen(uri);
+	m_hash = calc_hash(uri, m_uri_length);
 }
 
 std::string Song::getURI(unsigned idx) const
@@ -203,16 +276,46 @@ std::string Song::getPriority(unsigned idx) const
 
 std::string MPD::Song::getTags(GetFunction f) const
 {
-	assert(m_song);
-	unsigned idx = 0;
 	std::string result;
-	for (std::string tag; !(tag = (this->*f)(idx)).empty(); ++idx)
-	{
-		if (!result.empty())
+	appendTags(result, f);
+	return result;
+}
+
+void Song::appendTags(std::string &result, GetFunction f) const
+{
+	assert(m_song);
+	bool first = true;
+	forEachTag(f, [&result, &first](const char *value, size_t length) {
+		if (!first)
 			result += TagsSeparator;
-		result += tag;
+		result.append(value, length);
+		first = false;
+	});
+}
+
+bool Song::isTagGetter(GetFunction f, mpd_tag_type &type)
+{
+	static const std::pair<GetFunction, mpd_tag_type> getters[] = {
+		{ &Song::getArtist, MPD_TAG_ARTIST },
+		{ &Song::getTitle, MPD_TAG_TITLE },
+		{ &Song::getAlbum, MPD_TAG_ALBUM },
+		{ &Song::getAlbumArtist, MPD_TAG_ALBUM_ARTIST },
+		{ &Song::getDate, MPD_TAG_DATE },
+		{ &Song::getGenre, MPD_TAG_GENRE },
+		{ &Song::getComposer, MPD_TAG_COMPOSER },
+		{ &Song::getPerformer, MPD_TAG_PERFORMER },
+		{ &Song::getDisc, MPD_TAG_DISC },
+		{ &Song::getComment, MPD_TAG_COMMENT },
+	};
+	for (const auto &getter : getters)
+	{
+		if (getter.first == f)
+		{
+			type = getter.second;
+			return true;
+		}
 	}
-	return result;
+	return false;
 }
 
 unsigned Song::getDuration() const
@@ -227,6 +330,13 @@ unsigned Song::getPosition() const
 	return mpd_song_get_pos(m_song.get());
 }
 
+void Song::setPosition(unsigned pos)
+{
+	assert(m_song);
+	m_song = std::shared_ptr<mpd_song>(mpd_song_dup(m_song.get()), mpd_song_free);
+	mpd_song_set_pos(m_song.get(), pos);
+}
+
 unsigned Song::getID() const
 {
 	assert(m_song);
@@ -263,6 +373,37 @@ bool Song::empty() const
 	return m_song.get() == 0;
 }
 
+Song Song::intern(Song s)
+{
+	if (s.empty() || mpd_song_get_last_modified(s.m_song.get()) == 0)
+		return s;
+
+	boost::lock_guard<boost::mutex> lock(interned_songs_mutex);
+	auto range = interned_songs.equal_range(s.m_hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		auto song = it->second.lock();
+		if (song && sameSong(song.get(), s.m_song.get()))
+		{
+			s.m_song = std::move(song);
+			return s;
+		}
+	}
+	interned_songs.emplace(s.m_hash, s.m_song);
+	if (interned_songs.size() >= interned_songs_sweep_size)
+	{
+		for (auto it = interned_songs.begin(); it != interned_songs.end();)
+		{
+			if (it->second.expired())
+				it = interned_songs.erase(it);
+			else
+				++it;
+		}
+		interned_songs_sweep_size = std::max(size_t(1024), 2*interned_songs.size());
+	}
+	return s;
+}
+
 std::string Song::ShowTime(unsigned length)
 {
 	int hours = length/3600;
@@ -39,21 +39,28 @@ struct Song
 
 	typedef std::string (Song::*GetFunction)(unsigned) const;
 	
-	Song() : m_hash(0) { }
+	Song() : m_hash(0), m_uri_length(0) { }
 	virtual ~Song() { }
 	
 	Song(mpd_song *s);
 
-	Song(const Song &rhs) : m_song(rhs.m_song), m_hash(rhs.m_hash) { }
-	Song(Song &&rhs) : m_song(std::move(rhs.m_song)), m_hash(rhs.m_hash) { }
+	Song(const Song &rhs)
+	: m_song(rhs.m_song), m_hash(rhs.m_hash), m_uri_length(rhs.m_uri_length) { }
+	Song(Song &&rhs)
+	: m_song(std::move(rhs.m_song)), m_hash(rhs.m_hash), m_uri_length(rhs.m_uri_length) { }
 	Song &operator=(Song rhs)
 	{
 		m_song = std::move(rhs.m_song);
 		m_hash = rhs.m_hash;
+		m_uri_length = rhs.m_uri_length;
 		return *this;
 	}
 	
 	std::string get(mpd_tag_type type, unsigned idx = 0) const;
+
+	/// @return value of the tag or null pointer if there is none. Unlike
+	/// get(), it doesn't allocate. The value is valid as long as the song.
+	virtual const char *getTagValue(mpd_tag_type type, unsigned idx = 0) const;
 	
 	virtual std::string getURI(unsigned idx = 0) const;
 	virtual std::string getName(unsigned idx = 0) const;
@@ -74,6 +81,15 @@ struct Song
 	virtual std::string getPriority(unsigned idx = 0) const;
 	
 	virtual std::string getTags(GetFunction f) const;
+
+	/// Appends the result of getTags(f) to the string.
+	void appendTags(std::string &result, GetFunction f) const;
+
+	/// Calls fun(value, length) for each of the values joined by getTags(f).
+	/// Values stored in the song are passed without copying them, the
+	/// pointer is valid only for the duration of the call.
+	template <typename FunctionT>
+	void forEachTag(GetFunction f, FunctionT fun) const;
 	
 	virtual unsigned getDuration() const;
 	virtual unsigned getPosition() const;
@@ -86,11 +102,17 @@ struct Song
 	
 	virtual bool empty() const;
 	
+	/// Sets position of the song in the playlist. Data of the song is
+	/// copied first, as it may be shared with other songs.
+	void setPosition(unsigned pos);
+	
 	bool operator==(const Song &rhs) const
 	{
-		if (m_hash != rhs.m_hash)
+		if (m_song == rhs.m_song)
+			return true;
+		if (m_hash != rhs.m_hash || m_uri_length != rhs.m_uri_length)
 			return false;
-		return strcmp(c_uri(), rhs.c_uri()) == 0;
+		return memcmp(c_uri(), rhs.c_uri(), m_uri_length) == 0;
 	}
 	bool operator!=(const Song &rhs) const
 	{
@@ -99,15 +121,65 @@ struct Song
 	
 	const char *c_uri() const { return m_song ? mpd_song_get_uri(m_song.get()) : ""; }
 
+	/// @return true if both songs share their data, i.e. they're the same
+	/// song fetched from MPD (which isn't the case if its tags change).
+	bool sharesDataWith(const Song &rhs) const { return m_song == rhs.m_song; }
+
+	/// @return song that shares its data with an equal song that is still
+	/// alive (if there is one), so that the same songs fetched by different
+	/// screens are stored in memory only once. Songs are considered equal
+	/// if they have the same uri, tags, modification time, duration, position
+	/// and id. Songs without modification time are returned as they are.
+	static Song intern(Song s);
+
 	static std::string ShowTime(unsigned length);
 
 	static std::string TagsSeparator;
 
 private:
+	/// @return true if f returns plain values of a tag (stored in type).
+	static bool isTagGetter(GetFunction f, mpd_tag_type &type);
+
 	std::shared_ptr<mpd_song> m_song;
 	size_t m_hash;
+	size_t m_uri_length;
 };
 
+template <typename FunctionT>
+void Song::forEachTag(GetFunction f, FunctionT fun) const
+{
+	mpd_tag_type type;
+	if (isTagGetter(f, type))
+	{
+		for (unsigned idx = 0;; ++idx)
+		{
+			const char *value = getTagValue(type, idx);
+			if (value == nullptr || *value == '\0')
+				break;
+			fun(value, strlen(value));
+		}
+	}
+	else if (f == &Song::getURI)
+	{
+		const char *uri = c_uri();
+		fun(uri, strlen(uri));
+	}
+	else if (f == &Song::getName && getTagValue(MPD_TAG_NAME) == nullptr)
+	{
+		const char *uri = c_uri();
+		const char *name = strrchr(uri, '/');
+		name = name != nullptr ? name+1 : uri;
+		fun(name, strlen(name));
+	}
+	else
+	{
+		// computed values, usually short enough not to allocate
+		std::string value;
+		for (unsigned idx = 0; !(value = (this->*f)(idx)).empty(); ++idx)
+			fun(value.c_str(), value.length());
+	}
+}
+
 }
 
 #endif // NCMPCPP_SONG_H
@@ -0,0 +1,268 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "song_index.h"
+
+namespace {
+
+bool isWordChar(unsigned char c)
+{
+	// treat all bytes of multibyte UTF-8 characters as parts of words
+	return (c >= '0' && c <= '9')
+	    || (c >= 'a' && c <= 'z')
+	    || (c >= 'A' && c <= 'Z')
+	    || c >= 0x80;
+}
+
+template <typename F>
+void forEachWord(const std::string &s, F f)
+{
+	std::string word;
+	for (auto it = s.begin();;)
+	{
+		it = std::find_if(it, s.end(), isWordChar);
+		if (it == s.end())
+			break;
+		auto word_end = std::find_if_not(it, s.end(), isWordChar);
+		word.assign(it, word_end);
+		for (auto &c : word)
+			if (c >= 'A' && c <= 'Z')
+				c += 'a'-'A';
+		f(word);
+		it = word_end;
+	}
+}
+
+/// Word of a plain pattern along with whether it's known to be
+/// at the beginning and/or end of a word in a matching string.
+struct PatternWord
+{
+	std::string text;
+	bool begins_word;
+	bool ends_word;
+};
+
+/// @return words that need to be contained in a string matching given
+/// regular expression, empty if it's not a plain string (possibly
+/// anchored at the beginning or end).
+std::vector<PatternWord> plainWords(std::string pattern, bool icase)
+{
+	std::vector<PatternWord> result;
+	bool anchored_begin = false, anchored_end = false;
+	if (!pattern.empty() && pattern.front() == '^')
+	{
+		pattern.erase(pattern.begin());
+		anchored_begin = true;
+	}
+	if (!pattern.empty() && pattern.back() == '$')
+	{
+		pattern.pop_back();
+		anchored_end = true;
+	}
+	if (pattern.find_first_of(".[]{}()\\*+?|^$") != std::string::npos)
+		return result;
+	for (auto it = pattern.begin();;)
+	{
+		it = std::find_if(it, pattern.end(), isWordChar);
+		if (it == pattern.end())
+			break;
+		auto word_end = std::find_if_not(it, pattern.end(), isWordChar);
+		PatternWord word;
+		word.text.assign(it, word_end);
+		word.begins_word = it != pattern.begin() || anchored_begin;
+		word.ends_word = word_end != pattern.end() || anchored_end;
+		it = word_end;
+		// letters outside of ASCII can match case insensitively
+		// in a number of ways, so don't look them up.
+		if (icase && std::any_of(word.text.begin(), word.text.end(), [](unsigned char c) { return c >= 0x80; }))
+			continue;
+		for (auto &c : word.text)
+			if (c >= 'A' && c <= 'Z')
+				c += 'a'-'A';
+		result.push_back(std::move(word));
+	}
+	return result;
+}
+
+SongIndex::PostingList intersection(const SongIndex::PostingList &a, const SongIndex::PostingList &b)
+{
+	SongIndex::PostingList result;
+	std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+	return result;
+}
+
+void merge(SongIndex::PostingList &to, const SongIndex::PostingList &from)
+{
+	SongIndex::PostingList result;
+	result.reserve(to.size() + from.size());
+	std::set_union(to.begin(), to.end(), from.begin(), from.end(), std::back_inserter(result));
+	to = std::move(result);
+}
+
+/// @return sorted ids of songs that contain given word in a
+/// tag with given dictionary of words.
+SongIndex::PostingList containing(const SongIndex::Dictionary &dict, const PatternWord &word)
+{
+	SongIndex::PostingList result;
+	if (word.begins_word && word.ends_word)
+	{
+		auto entry = dict.find(word.text);
+		if (entry != dict.end())
+			result = entry->second;
+		return result;
+	}
+	if (word.begins_word)
+	{
+		// words starting with the given one are adjacent in the dictionary
+		for (auto entry = dict.lower_bound(word.text);
+		     entry != dict.end() && entry->first.compare(0, word.text.length(), word.text) == 0;
+		     ++entry)
+			result.insert(result.end(), entry->second.begin(), entry->second.end());
+	}
+	else
+	{
+		// the word can be an arbitrary part of an indexed word
+		for (const auto &entry : dict)
+		{
+			auto pos = word.ends_word
+				? entry.first.length() - std::min(entry.first.length(), word.text.length())
+				: 0;
+			if (entry.first.find(word.text, pos) != std::string::npos)
+				result.insert(result.end(), entry.second.begin(), entry.second.end());
+		}
+	}
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	return result;
+}
+
+SongIndex::PostingList fieldCandidates(const SongIndex::Dictionary &dict,
+	const std::vector<PatternWord> &words)
+{
+	SongIndex::PostingList result;
+	for (auto word = words.begin(); word != words.end(); ++word)
+	{
+		if (word == words.begin())
+			result = containing(dict, *word);
+		else
+			result = intersection(result, containing(dict, *word));
+		if (result.empty())
+			break;
+	}
+	return result;
+}
+
+}
+
+const MPD::Song::GetFunction SongIndex::Fields[] = {
+	&MPD::Song::getArtist,
+	&MPD::Song::getAlbumArtist,
+	&MPD::Song::getTitle,
+	&MPD::Song::getAlbum,
+	&MPD::Song::getName,
+	&MPD::Song::getComposer,
+	&MPD::Song::getPerformer,
+	&MPD::Song::getGenre,
+	&MPD::Song::getDate,
+	&MPD::Song::getComment
+};
+
+const size_t SongIndex::FieldsNumber = sizeof(SongIndex::Fields)/sizeof(*SongIndex::Fields);
+
+SongIndex::SongIndex()
+: m_dictionaries(FieldsNumber)
+{ }
+
+void SongIndex::clear()
+{
+	for (auto &dict : m_dictionaries)
+		dict.clear();
+}
+
+void SongIndex::add(size_t id, const MPD::Song &s)
+{
+	for (size_t i = 0; i < FieldsNumber; ++i)
+	{
+		auto &dict = m_dictionaries[i];
+		forEachWord((s.*Fields[i])(0), [&dict, id](const std::string &word) {
+			auto &postings = dict[word];
+			assert(postings.empty() || postings.back() <= id);
+			if (postings.empty() || postings.back() != id)
+				postings.push_back(id);
+		});
+	}
+}
+
+void SongIndex::remove(const std::vector<bool> &removed)
+{
+	// number of removed songs preceding each song
+	std::vector<size_t> shift(removed.size());
+	for (size_t i = 0, removed_so_far = 0; i < removed.size(); ++i)
+	{
+		shift[i] = removed_so_far;
+		if (removed[i])
+			++removed_so_far;
+	}
+	for (auto &dict : m_dictionaries)
+	{
+		for (auto entry = dict.begin(); entry != dict.end();)
+		{
+			auto &postings = entry->second;
+			auto out = postings.begin();
+			for (auto id : postings)
+			{
+				assert(id < removed.size());
+				if (!removed[id])
+					*out++ = id - shift[id];
+			}
+			postings.erase(out, postings.end());
+			if (postings.empty())
+				entry = dict.erase(entry);
+			else
+				++entry;
+		}
+	}
+}
+
+boost::optional<SongIndex::PostingList> SongIndex::candidates(
+	MPD::Song::GetFunction field, const std::string &pattern, bool icase) const
+{
+	boost::optional<PostingList> result;
+	auto words = plainWords(pattern, icase);
+	if (words.empty())
+		return result;
+	if (field == nullptr)
+	{
+		result = PostingList();
+		for (const auto &dict : m_dictionaries)
+			merge(*result, fieldCandidates(dict, words));
+	}
+	else
+	{
+		auto it = std::find(Fields, Fields+FieldsNumber, field);
+		if (it != Fields+FieldsNumber)
+			result = fieldCandidates(m_dictionaries[it-Fields], words);
+	}
+	return result;
+}
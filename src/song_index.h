@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_SONG_INDEX_H
+#define NCMPCPP_SONG_INDEX_H
+
+#include <boost/optional.hpp>
+#include <map>
+#include <vector>
+
+#include "song.h"
+
+/// Inverted index of words contained in tags of a list of songs,
+/// identified by their positions in the list. It's used for narrowing
+/// the set of songs a regular expression needs to be matched against.
+struct SongIndex
+{
+	typedef std::vector<size_t> PostingList;
+	typedef std::map<std::string, PostingList> Dictionary;
+
+	/// Tags that are indexed.
+	static const MPD::Song::GetFunction Fields[];
+	static const size_t FieldsNumber;
+
+	SongIndex();
+
+	void clear();
+
+	/// Indexes song with given id (ids need to be added in increasing order).
+	void add(size_t id, const MPD::Song &s);
+
+	/// Removes songs marked in the mask and renumbers the remaining ones so
+	/// that they correspond to positions in the list without removed songs.
+	void remove(const std::vector<bool> &removed);
+
+	/// @return sorted ids of songs whose tag accessed by given getter (or any
+	/// indexed tag if getter is null) might match the regular expression or
+	/// nothing if the expression doesn't allow for ruling out any song.
+	boost::optional<PostingList> candidates(MPD::Song::GetFunction field,
+		const std::string &pattern, bool icase) const;
+
+private:
+	std::vector<Dictionary> m_dictionaries;
+};
+
+#endif // NCMPCPP_SONG_INDEX_H
@@ -172,50 +172,38 @@ void SortPlaylistDialog::sort() const
 		return;
 
 	size_t start_pos = begin - pl.begin();
-	std::vector<MPD::Song> playlist;
-	playlist.reserve(end - begin);
+	
+	Statusbar::print("Sorting...");
+	// precompute sort keys, so that tags are retrieved only once per song
+	std::vector<MPD::Song::GetFunction> getters;
+	for (auto it = w.beginV(); it->item().second; ++it)
+		getters.push_back(it->item().second);
+	std::vector<std::vector<std::string>> keys;
+	keys.reserve(end - begin);
 	for (; begin != end; ++begin)
-		playlist.push_back(begin->value());
+	{
+		keys.push_back(std::vector<std::string>());
+		keys.back().reserve(getters.size());
+		for (const auto &getter : getters)
+			keys.back().push_back(begin->value().getTags(getter));
+	}
 	
-	typedef std::vector<MPD::Song>::iterator Iterator;
 	LocaleStringComparison cmp(std::locale(), Config.ignore_leading_the);
-	std::function<void(Iterator, Iterator)> iter_swap, quick_sort;
-	auto song_cmp = [this, &cmp](const MPD::Song &a, const MPD::Song &b) -> bool {
-		for (auto it = w.beginV();  it->item().second; ++it)
+	std::vector<size_t> permutation(keys.size());
+	for (size_t i = 0; i < permutation.size(); ++i)
+		permutation[i] = i;
+	std::stable_sort(permutation.begin(), permutation.end(), [&keys, &cmp](size_t a, size_t b) {
+		for (size_t i = 0; i < keys[a].size(); ++i)
 		{
-			int res = cmp(a.getTags(it->item().second),
-			              b.getTags(it->item().second));
+			int res = cmp(keys[a][i], keys[b][i]);
 			if (res != 0)
 				return res < 0;
 		}
-		return a.getPosition() < b.getPosition();
-	};
-	iter_swap = [&playlist, &start_pos](Iterator a, Iterator b) {
-		std::iter_swap(a, b);
-		Mpd.Swap(start_pos+a-playlist.begin(), start_pos+b-playlist.begin());
-	};
-	quick_sort = [this, &song_cmp, &quick_sort, &iter_swap](Iterator first, Iterator last) {
-		if (last-first > 1)
-		{
-			Iterator pivot = first+rand()%(last-first);
-			iter_swap(pivot, last-1);
-			pivot = last-1;
-			
-			Iterator tmp = first;
-			for (Iterator i = first; i != pivot; ++i)
-				if (song_cmp(*i, *pivot))
-					iter_swap(i, tmp++);
-			iter_swap(tmp, pivot);
-			
-			quick_sort(first, tmp);
-			quick_sort(tmp+1, last);
-		}
-	};
+		return false;
+	});
 	
-	Statusbar::print("Sorting...");
-	Mpd.StartCommandsList();
-	quick_sort(playlist.begin(), playlist.end());
-	Mpd.CommitCommandsList();
+	// the whole range is rearranged using as few commands as possible
+	permutePlaylist(start_pos, permutation);
 	Statusbar::print("Range sorted");
 	switchToPreviousScreen();
 }
@@ -18,12 +18,15 @@
  *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
  ***************************************************************************/
 
+#include <algorithm>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <netinet/tcp.h>
 #include <netinet/in.h>
+#include <unordered_map>
 
 #include "browser.h"
 #include "charset.h"
+#include "database.h"
 #include "format_impl.h"
 #include "global.h"
 #include "helpers.h"
@@ -43,6 +46,7 @@
 #include "title.h"
 #include "utility/string.h"
 
+using Global::MainHeight;
 using Global::myScreen;
 
 using Global::wFooter;
@@ -55,6 +59,11 @@ namespace {
 
 boost::posix_time::ptime past = boost::posix_time::from_time_t(0);
 
+// when the playlist is fetched from scratch, it's fetched in parts of this
+// size with user input handled in between, so that it doesn't block the UI.
+const size_t playlist_part_size = 1024;
+bool m_playlist_loading;
+
 size_t playing_song_scroll_begin = 0;
 size_t first_line_scroll_begin = 0;
 size_t second_line_scroll_begin = 0;
@@ -78,10 +87,130 @@ unsigned m_playlist_length;
 unsigned m_total_time;
 int m_volume;
 
+void setWindowTimeout()
+{
+	int nc_wtimeout = std::numeric_limits<int>::max();
+	applyToVisibleWindows([&nc_wtimeout](BaseScreen *s) {
+		nc_wtimeout = std::min(nc_wtimeout, s->windowTimeout());
+	});
+	// don't wait for input if there are parts of the playlist to fetch
+	if (m_playlist_loading)
+		nc_wtimeout = 0;
+	wFooter->setTimeout(nc_wtimeout);
+}
+
+/// Puts the song in the playlist at its position, which is either
+/// within the playlist or right after its end.
+void setPlaylistSong(MPD::Song s)
+{
+	auto &pl = myPlaylist->main();
+	size_t pos = s.getPosition();
+	myPlaylist->registerSong(s);
+	if (pos < pl.size())
+	{
+		// if song's already in playlist, replace it with a new one
+		MPD::Song &old_s = pl[pos].value();
+		myPlaylist->unregisterSong(old_s);
+		old_s = std::move(s);
+		myPlaylist->songChanged(pos);
+	}
+	else // otherwise just add it to playlist
+	{
+		pl.addItem(std::move(s));
+		myPlaylist->songChanged(pl.size()-1);
+	}
+}
+
+/// Fetches songs that changed since given version of the playlist. Only
+/// positions and ids of changed songs are fetched at first, so that songs
+/// that were merely moved are taken from the playlist instead.
+std::vector<MPD::Song> getPlaylistChanges(unsigned previous_version)
+{
+	// distance between positions of songs to fetch at which
+	// it's better to fetch the ones in between than to split
+	// the request into two.
+	const unsigned max_position_gap = 32;
+
+	const auto &pl = myPlaylist->main();
+	std::vector<std::pair<unsigned, unsigned>> changes;
+	std::unordered_map<unsigned, size_t> change_of_id;
+	MPD::PositionIdIterator c = Mpd.GetPlaylistChangesPosId(previous_version), end;
+	for (; c != end; ++c)
+	{
+		// songs that weren't fetched yet will be fetched as they are now
+		if (m_playlist_loading && c->first >= pl.size())
+			continue;
+		change_of_id[c->second] = changes.size();
+		changes.push_back(*c);
+	}
+
+	std::vector<MPD::Song> songs(changes.size());
+	if (!changes.empty())
+	{
+		for (size_t i = 0; i < pl.size(); ++i)
+		{
+			auto it = change_of_id.find(pl[i].value().getID());
+			// if the song is at the same position, its tags changed
+			if (it != change_of_id.end() && changes[it->second].first != i)
+			{
+				MPD::Song &s = songs[it->second];
+				s = pl[i].value();
+				s.setPosition(changes[it->second].first);
+			}
+		}
+	}
+
+	std::unordered_map<unsigned, size_t> change_of_position;
+	std::vector<unsigned> positions;
+	for (size_t i = 0; i < changes.size(); ++i)
+	{
+		if (songs[i].empty())
+		{
+			change_of_position[changes[i].first] = i;
+			positions.push_back(changes[i].first);
+		}
+	}
+	std::sort(positions.begin(), positions.end());
+	for (size_t i = 0, j; i < positions.size(); i = j)
+	{
+		for (j = i+1; j < positions.size(); ++j)
+			if (positions[j]-positions[j-1] > max_position_gap)
+				break;
+		MPD::SongIterator s = Mpd.GetPlaylistRange(positions[i], positions[j-1]+1), last;
+		for (; s != last; ++s)
+		{
+			auto it = change_of_position.find(s->getPosition());
+			if (it != change_of_position.end())
+				songs[it->second] = std::move(*s);
+		}
+	}
+	return songs;
+}
+
+/// Fetches next part of the playlist that is being loaded, at
+/// least up to the given position (if it's within the playlist).
+void loadPlaylistPart(size_t min_end)
+{
+	size_t start = myPlaylist->main().size();
+	size_t end = std::min<size_t>(
+		std::max(start+playlist_part_size, min_end),
+		m_playlist_length
+	);
+	size_t fetched = 0;
+	for (MPD::SongIterator s = Mpd.GetPlaylistRange(start, end), last; s != last; ++s, ++fetched)
+		setPlaylistSong(std::move(*s));
+	// if fewer songs were fetched, the playlist changed in the meantime
+	// and missing ones will be fetched when the change is handled.
+	if (end == m_playlist_length || fetched < end-start)
+		m_playlist_loading = false;
+	myPlaylist->reloadTotalLength();
+	myPlaylist->reloadRemaining();
+}
+
 void drawTitle(const MPD::Song &np)
 {
 	assert(!np.empty());
-	windowTitle(Format::stringify<char>(Config.song_window_title_format, &np));
+	windowTitle(Format::stringifyCached(Config.song_window_title_format, np));
 }
 
 std::string playerStateToString(MPD::PlayerState ps)
@@ -139,6 +268,7 @@ void initialize_status()
 {
 	// get full info about new connection
 	Status::update(-1);
+	Database::invalidate();
 
 	if (Config.jump_to_now_playing_song_at_start)
 	{
@@ -154,8 +284,12 @@ void initialize_status()
 	// Set TCP_NODELAY on the tcp socket as we are using write-write-read pattern
 	// a lot (noidle - write, command - write, then read the result of command),
 	// which kills the performance.
+	// Commands are sent through the other socket if idle connection is
+	// a dedicated one, so set it on both.
 	int flag = 1;
-	setsockopt(Mpd.GetFD(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+	setsockopt(Mpd.GetCommandFD(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+	if (Mpd.GetFD() != Mpd.GetCommandFD())
+		setsockopt(Mpd.GetFD(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
 
 	myBrowser->fetchSupportedExtensions();
 #	ifdef ENABLE_OUTPUTS
@@ -207,19 +341,25 @@ void Status::trace(bool update_timer, bool update_window_timeout)
 	if (update_timer)
 		Timer = boost::posix_time::microsec_clock::local_time();
 	if (update_window_timeout)
-	{
-		// set appropriate window timeout
-		int nc_wtimeout = std::numeric_limits<int>::max();
-		applyToVisibleWindows([&nc_wtimeout](BaseScreen *s) {
-			nc_wtimeout = std::min(nc_wtimeout, s->windowTimeout());
-		});
-		wFooter->setTimeout(nc_wtimeout);
-	}
+		setWindowTimeout();
 	if (Mpd.Connected())
 	{
 		if (!m_status_initialized)
 			initialize_status();
 
+		if (m_playlist_loading)
+		{
+			loadPlaylistPart(0);
+			if (!m_playlist_loading)
+			{
+				// handle changes we might have missed while fetching
+				Status::update(MPD_IDLE_PLAYLIST);
+			}
+			else if (isVisible(myPlaylist))
+				myPlaylist->refresh();
+			setWindowTimeout();
+		}
+
 		if (m_player_state == MPD::psPlay
 		&&  Global::Timer - past > boost::posix_time::seconds(1))
 		{
@@ -232,6 +372,7 @@ void Status::trace(bool update_timer, bool update_window_timeout)
 		applyToVisibleWindows(&BaseScreen::update);
 		Statusbar::tryRedraw();
 
+		Mpd.KeepAlive();
 		Mpd.idle();
 	}
 }
@@ -247,6 +388,10 @@ void Status::update(int event)
 	m_total_time = st.totalTime();
 	m_volume = st.volume();
 	
+	// songs are displayed differently depending on the current one
+	if (event & (MPD_IDLE_PLAYLIST | MPD_IDLE_PLAYER))
+		NC::List::invalidateAll();
+	
 	if (event & MPD_IDLE_DATABASE)
 		Changes::database();
 	if (event & MPD_IDLE_STORED_PLAYLIST)
@@ -338,8 +483,10 @@ void Status::clear()
 	m_player_state = MPD::psUnknown;
 	m_playlist_length = 0;
 	m_playlist_version = 0;
+	m_playlist_loading = false;
 	m_total_time = 0;
 	m_volume = -1;
+	NC::List::invalidateAll();
 }
 
 /*************************************************************************/
@@ -404,50 +551,63 @@ int Status::State::volume()
 	return m_volume;
 }
 
+bool Status::State::playlistLoading()
+{
+	return m_playlist_loading;
+}
+
 /*************************************************************************/
 
 void Status::Changes::playlist(unsigned previous_version)
 {
-	if (m_playlist_length < myPlaylist->main().size())
+	if (previous_version == 0 && m_playlist_length > playlist_part_size)
 	{
-		auto it = myPlaylist->main().begin()+m_playlist_length;
-		auto end = myPlaylist->main().end();
-		for (; it != end; ++it)
-			myPlaylist->unregisterSong(it->value());
-		myPlaylist->main().resizeList(m_playlist_length);
+		// fetch long playlist from scratch in parts, starting with the one that
+		// contains the current song, so that it can be highlighted right away.
+		for (const auto &s : myPlaylist->main())
+			myPlaylist->unregisterSong(s.value());
+		myPlaylist->main().resizeList(0);
+		m_playlist_loading = true;
+		loadPlaylistPart(std::max(m_current_song_pos, 0) + MainHeight);
 	}
-
-	MPD::SongIterator s = Mpd.GetPlaylistChanges(previous_version), end;
-	for (; s != end; ++s)
+	else
 	{
-		size_t pos = s->getPosition();
-		myPlaylist->registerSong(*s);
-		if (pos < myPlaylist->main().size())
+		// moved songs need to be found before the playlist is truncated
+		auto songs = getPlaylistChanges(previous_version);
+		if (m_playlist_length < myPlaylist->main().size())
+		{
+			auto it = myPlaylist->main().begin()+m_playlist_length;
+			auto end = myPlaylist->main().end();
+			for (; it != end; ++it)
+				myPlaylist->unregisterSong(it->value());
+			myPlaylist->main().resizeList(m_playlist_length);
+		}
+		for (auto &s : songs)
 		{
-			// if song's already in playlist, replace it with a new one
-			MPD::Song &old_s = myPlaylist->main()[pos].value();
-			myPlaylist->unregisterSong(old_s);
-			old_s = std::move(*s);
+			// the playlist changed again while songs were fetched,
+			// missing ones will be fetched when the change is handled.
+			if (!s.empty() && s.getPosition() <= myPlaylist->main().size())
+				setPlaylistSong(std::move(s));
 		}
-		else // otherwise just add it to playlist
-			myPlaylist->main().addItem(std::move(*s));
 	}
 	
 	myPlaylist->reloadTotalLength();
 	myPlaylist->reloadRemaining();
 	
+	// hidden screens mark all their songs when they're switched to
+	auto changed_songs = myPlaylist->takeChangedSongs();
 	if (isVisible(myBrowser))
-		markSongsInPlaylist(myBrowser->main());
+		updateSongsInPlaylist(myBrowser->main(), changed_songs);
 	if (isVisible(mySearcher))
-		markSongsInPlaylist(mySearcher->main());
+		updateSongsInPlaylist(mySearcher->main(), changed_songs);
 	if (isVisible(myLibrary))
 	{
-		markSongsInPlaylist(myLibrary->Songs);
+		updateSongsInPlaylist(myLibrary->Songs, changed_songs);
 		myLibrary->Songs.refresh();
 	}
 	if (isVisible(myPlaylistEditor))
 	{
-		markSongsInPlaylist(myPlaylistEditor->Content);
+		updateSongsInPlaylist(myPlaylistEditor->Content, changed_songs);
 		myPlaylistEditor->Content.refresh();
 	}
 }
@@ -462,6 +622,7 @@ void Status::Changes::storedPlaylists()
 
 void Status::Changes::database()
 {
+	Database::invalidate();
 	myBrowser->requestUpdate();
 #	ifdef HAVE_TAGLIB_H
 	myTagEditor->Dirs->clear();
@@ -619,8 +780,7 @@ void Status::Changes::elapsedTime(bool update_elapsed)
 				else
 					tracklength += MPD::Song::ShowTime(m_elapsed_time);
 				tracklength += "]";
-				NC::WBuffer np_song;
-				Format::print(Config.song_status_wformat, np_song, &np);
+				const auto &np_song = Format::printCached(Config.song_status_wformat, np);
 				*wFooter << NC::XY(0, 1) << NC::TermManip::ClearToEOL << NC::Format::Bold << ps << ' ' << NC::Format::NoBold;
 				writeCyclicBuffer(np_song, *wFooter, playing_song_scroll_begin, wFooter->getWidth()-ps.length()-tracklength.length()-2, L" ** ");
 				*wFooter << NC::Format::Bold << NC::XY(wFooter->getWidth()-tracklength.length(), 1) << tracklength << NC::Format::NoBold;
@@ -647,9 +807,11 @@ void Status::Changes::elapsedTime(bool update_elapsed)
 				tracklength += " kbps)";
 			}
 
-			NC::WBuffer first, second;
-			Format::print(Config.new_header_first_line, first, &np);
-			Format::print(Config.new_header_second_line, second, &np);
+			// the result of printCached is valid only until its next call,
+			// so the first line needs to be copied before the second one
+			// is printed.
+			const auto first = Format::printCached(Config.new_header_first_line, np);
+			const auto &second = Format::printCached(Config.new_header_second_line, np);
 
 			size_t first_len = wideLength(first.str());
 			size_t first_margin = (std::max(tracklength.length()+1, VolumeState.length()))*2;
@@ -52,6 +52,9 @@ MPD::PlayerState player();
 unsigned totalTime();
 int volume();
 
+/// @return true if the playlist is being fetched in parts
+bool playlistLoading();
+
 }
 
 namespace Changes {
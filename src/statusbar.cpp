@@ -19,6 +19,7 @@
  ***************************************************************************/
 
 #include "global.h"
+#include "helpers.h"
 #include "settings.h"
 #include "status.h"
 #include "statusbar.h"
@@ -223,16 +224,23 @@ bool Statusbar::Helpers::ImmediatelyReturnOneOf::operator()(const char *s) const
 bool Statusbar::Helpers::FindImmediately::operator()(const char *s)
 {
 	using Global::myScreen;
-	Status::trace();
+	// don't update status between keystrokes, only when nothing is typed.
+	if (m_s == s)
+	{
+		Status::trace();
+		return true;
+	}
+	m_s = s;
 	try {
-		if (m_w->allowsSearching() && m_s != s)
+		if (m_w->allowsSearching())
 		{
+			if (IncrementalSearch::active() != nullptr)
+				IncrementalSearch::active()->setConstraint(s);
 			m_w->setSearchConstraint(s);
 			m_found = m_w->find(m_direction, Config.wrapped_search, false);
 			if (myScreen == myPlaylist)
 				myPlaylist->enableHighlighting();
 			myScreen->refreshWindow();
-			m_s = s;
 		}
 	} catch (boost::bad_expression &) { }
 	return true;
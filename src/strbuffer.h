@@ -21,8 +21,9 @@
 #ifndef NCMPCPP_STRBUFFER_H
 #define NCMPCPP_STRBUFFER_H
 
+#include <algorithm>
 #include <boost/lexical_cast.hpp>
-#include <map>
+#include "utility/small_vector.h"
 #include "window.h"
 
 namespace NC {
@@ -66,7 +67,10 @@ template <typename CharT> class BasicBuffer
 	
 public:
 	typedef std::basic_string<CharT> StringType;
-	typedef std::multimap<size_t, Property> Properties;
+	/// Properties sorted by their positions (the ones at the same position
+	/// are kept in order of insertion). Most buffers have only a few of them,
+	/// so they are usually stored without allocating any memory.
+	typedef SmallVector<std::pair<size_t, Property>, 4> Properties;
 	
 	const StringType &str() const { return m_string; }
 	const Properties &properties() const { return m_properties; }
@@ -75,19 +79,27 @@ public:
 	void addProperty(size_t position, PropertyT &&property, size_t id = -1)
 	{
 		assert(position <= m_string.size());
-		m_properties.emplace(position, Property(std::forward<PropertyT>(property), id));
+		Property p(std::forward<PropertyT>(property), id);
+		// properties are almost always appended at the end
+		if (m_properties.empty() || m_properties.back().first <= position)
+			m_properties.emplace_back(position, std::move(p));
+		else
+		{
+			auto it = std::upper_bound(m_properties.begin(), m_properties.end(), position,
+			                           [](size_t pos, const typename Properties::value_type &rhs) {
+				return pos < rhs.first;
+			});
+			m_properties.insert(it, std::make_pair(position, std::move(p)));
+		}
 	}
 
 	void removeProperties(size_t id = -1)
 	{
-		auto it = m_properties.begin();
-		while (it != m_properties.end())
-		{
-			if (it->second.id() == id)
-				m_properties.erase(it++);
-			else
-				++it;
-		}
+		auto last = std::remove_if(m_properties.begin(), m_properties.end(),
+		                           [id](const typename Properties::value_type &p) {
+			return p.second.id() == id;
+		});
+		m_properties.erase(last, m_properties.end());
 	}
 	
 	void clear()
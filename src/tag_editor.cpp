@@ -302,8 +302,9 @@ void TagEditor::update()
 			if (directory->path() == itsHighlightedDir)
 				Dirs->highlight(Dirs->size()-1);
 		};
-		std::sort(Dirs->beginV()+1, Dirs->endV(),
-			LocaleBasedSorting(std::locale(), Config.ignore_leading_the));
+		LocaleBasedSorting(std::locale(), Config.ignore_leading_the).sort(
+			Dirs->beginV()+1, Dirs->endV()
+		);
 		Dirs->display();
 	}
 	
@@ -313,13 +314,16 @@ void TagEditor::update()
 		MPD::SongIterator s = Mpd.GetSongs(Dirs->current()->value().second), end;
 		for (; s != end; ++s)
 			Tags->addItem(std::move(*s));
-		std::sort(Tags->beginV(), Tags->endV(),
-			LocaleBasedSorting(std::locale(), Config.ignore_leading_the));
+		LocaleBasedSorting(std::locale(), Config.ignore_leading_the).sort(
+			Tags->beginV(), Tags->endV()
+		);
 		Tags->refresh();
 	}
 	
 	if (w == TagTypes && TagTypes->choice() < 13)
 	{
+		// displayed tag depends on the choice in TagTypes
+		Tags->invalidate();
 		Tags->refresh();
 	}
 	else if (TagTypes->choice() >= 13)
@@ -0,0 +1,120 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "format.h"
+#include "tests/format_reference.h"
+#include "utility/type_conversions.h"
+
+namespace {
+
+volatile size_t sink;
+
+/// Prints the best of a few runs of the function applied to all songs.
+void measure(const char *name, const std::vector<MPD::Song> &songs,
+             const std::function<size_t(const MPD::Song &)> &f)
+{
+	double best = 0;
+	for (int run = 0; run < 5; ++run)
+	{
+		auto start = std::chrono::steady_clock::now();
+		size_t total = 0;
+		for (const auto &s : songs)
+			total += f(s);
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		sink = total;
+		if (run == 0 || elapsed.count() < best)
+			best = elapsed.count();
+	}
+	std::printf("  %-22s %8.1f ns/song\n", name, best / songs.size());
+}
+
+void benchmark(const char *name, const Format::AST<char> &ast, const std::vector<MPD::Song> &songs)
+{
+	std::printf("%s:\n", name);
+	measure("print", songs, [&ast](const MPD::Song &s) {
+		NC::Buffer buffer;
+		Format::print(ast, buffer, &s);
+		return buffer.str().length();
+	});
+	measure("print (visitor)", songs, [&ast](const MPD::Song &s) {
+		NC::Buffer buffer;
+		ReferenceFormat::print(ast, buffer, &s);
+		return buffer.str().length();
+	});
+	measure("stringify", songs, [&ast](const MPD::Song &s) {
+		return Format::stringify(ast, &s).length();
+	});
+	measure("stringify (visitor)", songs, [&ast](const MPD::Song &s) {
+		return ReferenceFormat::stringify(ast, &s).length();
+	});
+}
+
+/// Builds the format used in columns mode the same way the configuration does.
+Format::AST<char> columnsFormat(const std::vector<std::string> &columns)
+{
+	std::vector<Format::Expression<char>> result;
+	for (const auto &column : columns)
+	{
+		if (!result.empty())
+			result.push_back(" ");
+		Format::FirstOf<char> first_of;
+		for (const auto &type : column)
+		{
+			auto f = charToGetFunction(type);
+			assert(f != nullptr);
+			first_of.base().push_back(f);
+		}
+		result.push_back(std::move(first_of));
+	}
+	return Format::AST<char>(std::move(result));
+}
+
+}
+
+int main()
+{
+	// a typical library: every song has artist, album and title,
+	// some also have album artist and track number.
+	std::vector<MPD::Song> songs;
+	for (size_t i = 0; i < 10000; ++i)
+	{
+		std::map<mpd_tag_type, std::vector<std::string>> tags;
+		tags[MPD_TAG_ARTIST] = { "Artist " + std::to_string(i / 100) };
+		tags[MPD_TAG_ALBUM] = { "Album Title " + std::to_string(i / 10) };
+		tags[MPD_TAG_TITLE] = { "Song Title Number " + std::to_string(i) };
+		if (i % 3 == 0)
+			tags[MPD_TAG_ALBUM_ARTIST] = { "Album Artist " + std::to_string(i / 100) };
+		if (i % 2 == 0)
+			tags[MPD_TAG_TRACK] = { std::to_string(i % 10 + 1) };
+		songs.push_back(makeSong("music/artist/album/" + std::to_string(i) + ".flac", tags, 180 + i % 240));
+	}
+
+	// defaults of song_list_format and song_columns_mode_format
+	benchmark("song_list_format", Format::parse("{%a - }{%t}|{$8%f$9}$R{$3(%l)$9}"), songs);
+	benchmark("song_columns_mode_format", columnsFormat({ "a", "N", "tf", "b", "l" }), songs);
+	return 0;
+}
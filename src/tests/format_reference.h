@@ -0,0 +1,233 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_TESTS_FORMAT_REFERENCE_H
+#define NCMPCPP_TESTS_FORMAT_REFERENCE_H
+
+#include <boost/variant.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "format_impl.h"
+
+// Recursive visitor that formats were printed with before they were
+// compiled into programs, used as a reference for Format::Printer.
+namespace ReferenceFormat {
+
+using Format::operator+=;
+using Format::Result;
+
+template <typename CharT, typename OutputT, typename SecondOutputT = OutputT>
+struct Printer: boost::static_visitor<Result>
+{
+	typedef std::basic_string<CharT> StringT;
+
+	Printer(OutputT &os, const MPD::Song *song, SecondOutputT *second_os, const unsigned flags)
+	: m_output(os)
+	, m_song(song)
+	, m_output_switched(false)
+	, m_second_os(second_os)
+	, m_no_output(0)
+	, m_flags(flags)
+	{ }
+
+	Result operator()(const StringT &s)
+	{
+		if (!s.empty())
+		{
+			output(s);
+			return Result::Ok;
+		}
+		else
+			return Result::Empty;
+	}
+
+	Result operator()(const NC::Color &c)
+	{
+		if (m_flags & Format::Flags::Color)
+			output(c);
+		return Result::Empty;
+	}
+
+	Result operator()(NC::Format fmt)
+	{
+		if (m_flags & Format::Flags::Format)
+			output(fmt);
+		return Result::Empty;
+	}
+
+	Result operator()(Format::OutputSwitch)
+	{
+		if (!m_no_output)
+			m_output_switched = true;
+		return Result::Ok;
+	}
+
+	Result operator()(const Format::SongTag &st)
+	{
+		StringT tags;
+		if (m_flags & Format::Flags::Tag && m_song != nullptr)
+			appendTags(tags, st.function());
+		if (!tags.empty())
+		{
+			if (st.delimiter() > 0)
+			{
+				// shorten date/length by simple truncation
+				if (st.function() == &MPD::Song::getDate || st.function() == &MPD::Song::getLength)
+					tags.resize(st.delimiter());
+				else
+					tags = wideShorten(tags, st.delimiter());
+			}
+			output(tags);
+			return Result::Ok;
+		}
+		else
+			return Result::Missing;
+	}
+
+	// If all Empty -> Empty, if any Ok -> continue with Ok, if any Missing -> stop with Empty.
+	Result operator()(const Format::Group<CharT> &group)
+	{
+		auto visit = [this, &group] {
+			Result result = Result::Empty;
+			for (const auto &ex : group.base())
+			{
+				result += boost::apply_visitor(*this, ex);
+				if (result == Result::Missing)
+				{
+					result = Result::Empty;
+					break;
+				}
+			}
+			return result;
+		};
+
+		++m_no_output;
+		Result result = visit();
+		--m_no_output;
+		if (!m_no_output && result == Result::Ok)
+			visit();
+		return result;
+	}
+
+	// If all Empty or Missing -> Empty, if any Ok -> stop with Ok.
+	Result operator()(const Format::FirstOf<CharT> &first_of)
+	{
+		for (const auto &ex : first_of.base())
+		{
+			if (boost::apply_visitor(*this, ex) == Result::Ok)
+				return Result::Ok;
+		}
+		return Result::Empty;
+	}
+
+private:
+	void appendTags(std::string &tags, MPD::Song::GetFunction f) const
+	{
+		m_song->appendTags(tags, f);
+	}
+	void appendTags(std::wstring &tags, MPD::Song::GetFunction f) const
+	{
+		std::string utf8_tags;
+		m_song->appendTags(utf8_tags, f);
+		tags += convertString<wchar_t, char>::apply(utf8_tags);
+	}
+
+	void output(const StringT &s) const
+	{
+		if (!m_no_output)
+			outputTo(s);
+	}
+	void output(const NC::Color &c) const
+	{
+		if (!m_no_output)
+			outputTo(c);
+	}
+	void output(NC::Format fmt) const
+	{
+		if (!m_no_output)
+			outputTo(fmt);
+	}
+
+	template <typename ValueT>
+	void outputTo(const ValueT &value) const
+	{
+		if (m_output_switched && m_second_os != nullptr)
+			*m_second_os << value;
+		else
+			m_output << value;
+	}
+
+	OutputT &m_output;
+	const MPD::Song *m_song;
+
+	bool m_output_switched;
+	SecondOutputT *m_second_os;
+
+	unsigned m_no_output;
+	const unsigned m_flags;
+};
+
+template <typename CharT>
+void print(const Format::AST<CharT> &ast, NC::BasicBuffer<CharT> &buffer,
+           const MPD::Song *song, const unsigned flags = Format::Flags::All)
+{
+	Printer<CharT, NC::BasicBuffer<CharT>> printer(buffer, song, &buffer, flags);
+	for (const auto &ex : ast.base())
+		boost::apply_visitor(printer, ex);
+}
+
+template <typename CharT>
+std::basic_string<CharT> stringify(const Format::AST<CharT> &ast, const MPD::Song *song)
+{
+	// with tags only, the printed buffer contains nothing but the text
+	NC::BasicBuffer<CharT> buffer;
+	ReferenceFormat::print(ast, buffer, song, Format::Flags::Tag);
+	return buffer.str();
+}
+
+}
+
+/// @return song with given uri, tags and duration, created the same way
+/// as songs read from the database snapshot.
+inline MPD::Song makeSong(const std::string &uri,
+                          const std::map<mpd_tag_type, std::vector<std::string>> &tags,
+                          unsigned duration)
+{
+	mpd_pair pair = { "file", uri.c_str() };
+	mpd_song *s = mpd_song_begin(&pair);
+	for (const auto &tag : tags)
+	{
+		for (const auto &value : tag.second)
+		{
+			pair.name = mpd_tag_name(tag.first);
+			pair.value = value.c_str();
+			mpd_song_feed(s, &pair);
+		}
+	}
+	std::string time = std::to_string(duration);
+	pair.name = "Time";
+	pair.value = time.c_str();
+	mpd_song_feed(s, &pair);
+	return MPD::Song(s);
+}
+
+#endif // NCMPCPP_TESTS_FORMAT_REFERENCE_H
@@ -0,0 +1,219 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "format.h"
+#include "tests/format_reference.h"
+#include "utility/wide_string.h"
+
+namespace {
+
+int failures = 0;
+
+/// Writes properties of a buffer in a form that can be compared.
+struct PropertyWriter
+{
+	std::ostringstream os;
+};
+
+PropertyWriter &operator<<(PropertyWriter &w, const NC::Color &color)
+{
+	// colors don't expose their contents, so identify them
+	// by the order in which they were first encountered.
+	static std::vector<NC::Color> colors;
+	auto it = std::find(colors.begin(), colors.end(), color);
+	if (it == colors.end())
+		it = colors.insert(colors.end(), color);
+	w.os << "color" << (it - colors.begin());
+	return w;
+}
+
+PropertyWriter &operator<<(PropertyWriter &w, NC::Format format)
+{
+	w.os << "format" << int(format);
+	return w;
+}
+
+template <typename CharT>
+std::string dump(const NC::BasicBuffer<CharT> &buffer)
+{
+	PropertyWriter w;
+	w.os << ToString(std::basic_string<CharT>(buffer.str())) << '|';
+	for (const auto &p : buffer.properties())
+	{
+		w.os << p.first << ':';
+		w << p.second;
+		w.os << ',';
+	}
+	return w.os.str();
+}
+
+template <typename CharT>
+void check(const std::basic_string<CharT> &format, const std::vector<MPD::Song> &songs)
+{
+	const unsigned flag_sets[] = {
+		Format::Flags::All,
+		Format::Flags::None,
+		Format::Flags::Tag,
+		Format::Flags::Tag | Format::Flags::Color,
+		Format::Flags::Tag | Format::Flags::Format,
+		Format::Flags::Color | Format::Flags::Format | Format::Flags::OutputSwitch
+	};
+	auto ast = Format::parse(format);
+	auto tag_ast = Format::parse(format, Format::Flags::Tag);
+	for (size_t i = 0; i <= songs.size(); ++i)
+	{
+		const MPD::Song *s = i < songs.size() ? &songs[i] : nullptr;
+		for (auto flags : flag_sets)
+		{
+			NC::BasicBuffer<CharT> result, expected;
+			Format::print(ast, result, s, flags);
+			ReferenceFormat::print(ast, expected, s, flags);
+			if (dump(result) != dump(expected))
+			{
+				std::printf("print(\"%s\", flags = %u) for song %zu: \"%s\", expected: \"%s\"\n",
+					ToString(format).c_str(), flags, i, dump(result).c_str(), dump(expected).c_str());
+				++failures;
+			}
+		}
+		auto result = Format::stringify(tag_ast, s);
+		auto expected = ReferenceFormat::stringify(tag_ast, s);
+		if (result != expected)
+		{
+			std::printf("stringify(\"%s\") for song %zu: \"%s\", expected: \"%s\"\n",
+				ToString(format).c_str(), i, ToString(result).c_str(), ToString(expected).c_str());
+			++failures;
+		}
+	}
+}
+
+/// Generates random formats with nested groups and alternatives.
+struct FormatGenerator
+{
+	FormatGenerator(std::mt19937 &rng) : m_rng(rng) { }
+
+	std::string sequence(int depth)
+	{
+		std::string result;
+		for (int i = 1 + m_rng() % 4; i > 0; --i)
+			result += atom(depth);
+		return result;
+	}
+
+private:
+	template <size_t N>
+	const char *choice(const char *(&values)[N])
+	{
+		return values[m_rng() % N];
+	}
+
+	std::string atom(int depth)
+	{
+		static const char *strings[] = { "a", " - ", "x y", "(", ")", ":", "%%", "$$" };
+		static const char *tags = "aAtbynNgcpdCPlDf";
+		static const char *colors[] = { "$1", "$3", "$9", "$(red)", "$(cyan_black)" };
+		static const char *formats[] = { "$b", "$/b", "$u", "$/u", "$r", "$/r", "$a", "$/a" };
+		switch (m_rng() % 7)
+		{
+			case 0:
+				return choice(strings);
+			case 1:
+			case 2:
+			{
+				std::string tag = "%";
+				if (m_rng() % 5 == 0)
+					tag += std::to_string(1 + m_rng() % 12);
+				return tag + tags[m_rng() % strlen(tags)];
+			}
+			case 3:
+				return choice(colors);
+			case 4:
+				return m_rng() % 2 ? choice(formats) : "$R";
+			default:
+			{
+				if (depth >= 4)
+					return "z";
+				std::string result;
+				for (int i = 1 + m_rng() % 3; i > 0; --i)
+				{
+					if (!result.empty())
+						result += '|';
+					result += "{" + sequence(depth+1) + "}";
+				}
+				return result;
+			}
+		}
+	}
+
+	std::mt19937 &m_rng;
+};
+
+}
+
+int main()
+{
+	std::mt19937 rng(1);
+
+	// songs with random subsets of tags (some with multiple values),
+	// both local and streams, with and without duration.
+	const char *values[] = { "x", "Long Title Here", "\xc5\xbc\xc3\xb3\xc5\x82w", "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e" };
+	std::vector<MPD::Song> songs;
+	for (int i = 0; i < 32; ++i)
+	{
+		std::map<mpd_tag_type, std::vector<std::string>> tags;
+		for (int type = 0; type < MPD_TAG_COUNT; ++type)
+		{
+			if (rng() % 2 == 0)
+				continue;
+			auto &tag = tags[static_cast<mpd_tag_type>(type)];
+			tag.push_back(values[rng() % 4]);
+			if (rng() % 4 == 0)
+				tag.push_back("second");
+		}
+		songs.push_back(makeSong(rng() % 2 ? "dir/file.mp3" : "http://stream", tags, rng() % 2 ? 0 : rng() % 5000));
+	}
+
+	std::vector<std::string> formats = {
+		"{%a - }{%t}|{$8%f$9}$R{$3(%l)$9}",
+		"{{%a{ \"%b\"{ (%y)}} - }{%t}}|{%f}",
+		"{%a}|{%A} {%N} {%t}|{%f} {%b} {%l}",
+		"{(%l) }{%a}|{%A}$R$b{%t}$/b"
+	};
+	FormatGenerator generator(rng);
+	for (int i = 0; i < 1000; ++i)
+		formats.push_back(generator.sequence(0));
+
+	for (const auto &format : formats)
+	{
+		check(format, songs);
+		check(ToWString(format), songs);
+	}
+
+	if (failures > 0)
+		std::printf("%d checks failed\n", failures);
+	return failures > 0 ? 1 : 0;
+}
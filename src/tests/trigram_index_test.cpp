@@ -0,0 +1,93 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "utility/trigram_index.h"
+
+namespace {
+
+int failures = 0;
+
+void check(const std::string &regex, RegexSyntax syntax, bool icase,
+           const std::vector<std::string> &expected)
+{
+	auto result = requiredLiterals(regex, syntax, icase);
+	if (result != expected)
+	{
+		std::printf("requiredLiterals(\"%s\"):", regex.c_str());
+		for (const auto &literal : result)
+			std::printf(" \"%s\"", literal.c_str());
+		std::printf(", expected:");
+		for (const auto &literal : expected)
+			std::printf(" \"%s\"", literal.c_str());
+		std::printf("\n");
+		++failures;
+	}
+}
+
+}
+
+int main()
+{
+	const auto basic = RegexSyntax::Basic;
+	const auto extended = RegexSyntax::Extended;
+	const auto literal = RegexSyntax::Literal;
+
+	// plain sequences and case folding
+	check("Pink Floyd", extended, true, {"pink floyd"});
+	check("Pink Floyd", extended, false, {"pink floyd"});
+	check("ab", extended, false, {});
+	check("abc.def", extended, false, {"abc", "def"});
+
+	// quantifiers
+	check("colou?r", extended, false, {"colo"});
+	check("colou{0,1}r", extended, false, {"colo"});
+	check("abcd+efg", extended, false, {"abcd", "efg"});
+	check("(abc)?def", extended, false, {"def"});
+	check("(abc){2}def", extended, false, {"abc", "def"});
+	check("abc|def", extended, false, {});
+
+	// basic expressions have different operators
+	check("colou\\{0,1\\}r", basic, false, {"colo"});
+	check("\\(abc\\)*def", basic, false, {"def"});
+	check("\\(abc\\)\\{1,2\\}def", basic, false, {"abc", "def"});
+	check("a(b)c{1}d+e?", basic, false, {"a(b)c{1}d+e?"});
+	check("abc\\|def", basic, false, {});
+	check("[\\]abc", basic, false, {"abc"});
+
+	// escapes
+	check("abc\\.def", extended, false, {"abc.def"});
+	check("abc\\.def", basic, false, {"abc.def"});
+	check("\\x41bc", extended, false, {});
+	check("\\0101bc", extended, false, {});
+	check("abc\\wdef", extended, false, {});
+	check("\\Qa.b\\E", extended, false, {});
+	check("abc\\>def", extended, false, {"abc", "def"});
+
+	// literal strings
+	check("a.b\\(c)", literal, false, {"a.b\\(c)"});
+
+	if (failures > 0)
+		std::printf("%d checks failed\n", failures);
+	return failures > 0 ? 1 : 0;
+}
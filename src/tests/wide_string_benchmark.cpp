@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "tests/wide_string_reference.h"
+#include "utility/wide_string.h"
+
+namespace {
+
+volatile size_t sink;
+
+/// Prints the best of a few runs of the function applied to all strings.
+void measure(const char *name, const std::vector<std::wstring> &strings,
+             const std::function<size_t(const std::wstring &)> &f)
+{
+	double best = 0;
+	for (int run = 0; run < 5; ++run)
+	{
+		auto start = std::chrono::steady_clock::now();
+		size_t total = 0;
+		for (const auto &ws : strings)
+			total += f(ws);
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		sink = total;
+		if (run == 0 || elapsed.count() < best)
+			best = elapsed.count();
+	}
+	std::printf("  %-22s %8.1f ns/string\n", name, best / strings.size());
+}
+
+void benchmark(const char *name, const std::vector<std::wstring> &strings)
+{
+	const size_t max_length = 30;
+	std::printf("%s:\n", name);
+	measure("wideLength", strings, [](const std::wstring &ws) {
+		return wideLength(ws);
+	});
+	measure("wideLength (wcwidth)", strings, [](const std::wstring &ws) {
+		return referenceWideLength(ws);
+	});
+	measure("wideCut", strings, [max_length](const std::wstring &ws) {
+		std::wstring result = ws;
+		wideCut(result, max_length);
+		return result.length();
+	});
+	measure("wideCut (wcwidth)", strings, [max_length](const std::wstring &ws) {
+		std::wstring result = ws;
+		referenceWideCut(result, max_length);
+		return result.length();
+	});
+	measure("wideShorten", strings, [max_length](const std::wstring &ws) {
+		return wideShorten(ws, max_length).length();
+	});
+	measure("wideShorten (wcwidth)", strings, [max_length](const std::wstring &ws) {
+		return referenceWideShorten(ws, max_length).length();
+	});
+}
+
+std::vector<std::wstring> strings(const std::wstring &sample)
+{
+	std::vector<std::wstring> result;
+	for (size_t i = 0; i < 100000; ++i)
+		result.push_back(sample.substr(0, 20 + i % (sample.length() - 20)));
+	return result;
+}
+
+}
+
+int main()
+{
+	if (std::setlocale(LC_ALL, "C.UTF-8") == nullptr
+	&&  std::setlocale(LC_ALL, "en_US.UTF-8") == nullptr)
+	{
+		std::printf("no UTF-8 locale available\n");
+		return 1;
+	}
+	benchmark("Latin", strings(
+		L"Pink Floyd - Wish You Were Here - 01 - Shine On You Crazy Diamond (Parts I-V)"
+	));
+	benchmark("CJK", strings(
+		L"\x5742\x672c\x9f8d\x4e00 - \x6226\x573a\x306e\x30e1\x30ea\x30fc\x30af\x30ea\x30b9\x30de\x30b9"
+		L" - \x6226\x573a\x306e\x30e1\x30ea\x30fc\x30af\x30ea\x30b9\x30de\x30b9 (\x30e9\x30a4\x30d6)"
+	));
+	benchmark("Mixed", strings(
+		L"Sigur R\xf3s - \xc1g\xe6tis Byrjun - Svefn-g-englar / \x5742\x672c\x9f8d\x4e00 Remix"
+	));
+	return 0;
+}
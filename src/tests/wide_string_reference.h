@@ -0,0 +1,91 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_TESTS_WIDE_STRING_REFERENCE_H
+#define NCMPCPP_TESTS_WIDE_STRING_REFERENCE_H
+
+#include <algorithm>
+#include <string>
+#include <wchar.h>
+
+// Plain implementations of functions from utility/wide_string.h that call
+// wcwidth for each character, used as a reference for the optimized ones.
+
+inline size_t referenceWideLength(const std::wstring &ws)
+{
+	size_t result = 0;
+	for (const auto &wc : ws)
+	{
+		int len = wcwidth(wc);
+		if (len < 0)
+			++result;
+		else
+			result += len;
+	}
+	return result;
+}
+
+inline void referenceWideCut(std::wstring &ws, size_t max_length)
+{
+	size_t i = 0;
+	int remained_len = max_length;
+	for (; i < ws.length(); ++i)
+	{
+		remained_len -= std::max(wcwidth(ws[i]), 1);
+		if (remained_len < 0)
+		{
+			ws.resize(i);
+			break;
+		}
+	}
+}
+
+inline std::wstring referenceWideShorten(const std::wstring &ws, size_t max_length)
+{
+	std::wstring result;
+	if (referenceWideLength(ws) > max_length)
+	{
+		const size_t half_max = max_length/2 - 1;
+		size_t len = 0;
+		for (auto it = ws.begin(); it != ws.end(); ++it)
+		{
+			len += wcwidth(*it);
+			if (len > half_max)
+				break;
+			result += *it;
+		}
+		len = 0;
+		std::wstring end;
+		for (auto it = ws.rbegin(); it != ws.rend(); ++it)
+		{
+			len += wcwidth(*it);
+			if (len > half_max)
+				break;
+			end += *it;
+		}
+		result += L"..";
+		result.append(end.rbegin(), end.rend());
+	}
+	else
+		result = ws;
+	return result;
+}
+
+#endif // NCMPCPP_TESTS_WIDE_STRING_REFERENCE_H
@@ -0,0 +1,102 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <clocale>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "tests/wide_string_reference.h"
+#include "utility/wide_string.h"
+
+namespace {
+
+int failures = 0;
+
+void report(const char *function, const std::wstring &ws, size_t max_length)
+{
+	std::printf("%s(", function);
+	for (auto wc : ws)
+		std::printf("\\x%x", unsigned(wc));
+	std::printf(", %zu) differs from the reference\n", max_length);
+	++failures;
+}
+
+void check(const std::wstring &ws, size_t max_length)
+{
+	if (wideLength(ws) != referenceWideLength(ws))
+		report("wideLength", ws, max_length);
+
+	std::wstring cut = ws, reference_cut = ws;
+	wideCut(cut, max_length);
+	referenceWideCut(reference_cut, max_length);
+	if (cut != reference_cut)
+		report("wideCut", ws, max_length);
+
+	if (max_length >= 2 && wideShorten(ws, max_length) != referenceWideShorten(ws, max_length))
+		report("wideShorten", ws, max_length);
+}
+
+}
+
+int main()
+{
+	if (std::setlocale(LC_ALL, "C.UTF-8") == nullptr
+	&&  std::setlocale(LC_ALL, "en_US.UTF-8") == nullptr)
+	{
+		std::printf("no UTF-8 locale available, skipping\n");
+		return 77;
+	}
+
+	// printable ASCII, control characters, Latin-1, combining
+	// marks, CJK, characters outside of BMP and unassigned ones.
+	const std::vector<wchar_t> characters = {
+		L'a', L'Z', L' ', L'~', L'.', 0x01, L'\t', 0x7f, 0x9f,
+		0xe9, 0xf1, 0x301, 0x200b, 0x4e00, 0x65e5, 0xac00, 0xff21,
+		0x1f600, 0x20000, 0xe000, 0xfffe, 0x378
+	};
+
+	std::mt19937 rng(1);
+	for (int i = 0; i < 200000; ++i)
+	{
+		// mostly ASCII strings with an occasional other character,
+		// so that both fast and slow paths are exercised.
+		std::wstring ws;
+		size_t length = rng() % 40;
+		bool ascii_only = rng() % 2;
+		for (size_t j = 0; j < length; ++j)
+		{
+			if (ascii_only || rng() % 4 != 0)
+				ws += wchar_t(0x20 + rng() % 0x5f);
+			else
+				ws += characters[rng() % characters.size()];
+		}
+		check(ws, rng() % 50);
+	}
+
+	// the whole Basic Multilingual Plane, as widths are looked up in a table
+	for (wchar_t wc = 0; wc < 0x10000; ++wc)
+		check(std::wstring(3, wc), 4);
+
+	if (failures > 0)
+		std::printf("%d checks failed\n", failures);
+	return failures > 0 ? 1 : 0;
+}
@@ -25,9 +25,9 @@
 
 namespace {
 
-bool hasTheWord(const std::string &s)
+bool hasTheWord(const char *s, size_t len)
 {
-	return s.length() >= 4
+	return len >= 4
 	&&     (s[0] == 't' || s[0] == 'T')
 	&&     (s[1] == 'h' || s[1] == 'H')
 	&&     (s[2] == 'e' || s[2] == 'E')
@@ -41,9 +41,9 @@ int LocaleStringComparison::compare(const char *a, size_t a_len, const char *b,
 	size_t ac_off = 0, bc_off = 0;
 	if (m_ignore_the)
 	{
-		if (hasTheWord(a))
+		if (hasTheWord(a, a_len))
 			ac_off += 4;
-		if (hasTheWord(b))
+		if (hasTheWord(b, b_len))
 			bc_off += 4;
 	}
 	return std::use_facet<std::collate<char>>(m_locale).compare(
@@ -51,6 +51,14 @@ int LocaleStringComparison::compare(const char *a, size_t a_len, const char *b,
 	);
 }
 
+std::string LocaleStringComparison::key(const char *s, size_t len) const
+{
+	size_t off = 0;
+	if (m_ignore_the && hasTheWord(s, len))
+		off += 4;
+	return std::use_facet<std::collate<char>>(m_locale).transform(s+off, s+len);
+}
+
 bool LocaleBasedItemSorting::operator()(const MPD::Item &a, const MPD::Item &b) const
 {
 	bool result = false;
@@ -109,3 +117,65 @@ bool LocaleBasedItemSorting::operator()(const MPD::Item &a, const MPD::Item &b)
 		result = a.type() < b.type();
 	return result;
 }
+
+std::string LocaleBasedItemSorting::key(const MPD::Item &item) const
+{
+	// items of different types are ordered by type first
+	std::string result(1, static_cast<char>(item.type()));
+	switch (m_sort_mode)
+	{
+		case SortMode::Name:
+			switch (item.type())
+			{
+				case MPD::Item::Type::Directory:
+					result += m_cmp.key(item.directory().path());
+					break;
+				case MPD::Item::Type::Playlist:
+					result += m_cmp.key(item.playlist().path());
+					break;
+				case MPD::Item::Type::Song:
+					result += m_cmp.key(item.song());
+					break;
+			}
+			break;
+		case SortMode::CustomFormat:
+			switch (item.type())
+			{
+				case MPD::Item::Type::Directory:
+					result += m_cmp.key(item.directory().path());
+					break;
+				case MPD::Item::Type::Playlist:
+					result += m_cmp.key(item.playlist().path());
+					break;
+				case MPD::Item::Type::Song:
+					result += m_cmp.key(Format::stringify<char>(Config.browser_sort_format, &item.song()));
+					break;
+			}
+			break;
+		case SortMode::ModificationTime:
+		{
+			time_t mtime = 0;
+			switch (item.type())
+			{
+				case MPD::Item::Type::Directory:
+					mtime = item.directory().lastModified();
+					break;
+				case MPD::Item::Type::Playlist:
+					mtime = item.playlist().lastModified();
+					break;
+				case MPD::Item::Type::Song:
+					mtime = item.song().getMTime();
+					break;
+			}
+			// newest first, so store complement of the
+			// (order preserving) unsigned representation.
+			uint64_t key = ~(static_cast<uint64_t>(mtime) ^ (uint64_t(1) << 63));
+			for (int shift = 56; shift >= 0; shift -= 8)
+				result += static_cast<char>((key >> shift) & 0xff);
+			break;
+		}
+		case SortMode::NoOp:
+			throw std::logic_error("can't sort with NoOp sorting mode");
+	}
+	return result;
+}
@@ -21,11 +21,64 @@
 #ifndef NCMPCPP_UTILITY_COMPARATORS_H
 #define NCMPCPP_UTILITY_COMPARATORS_H
 
+#include <cassert>
 #include <string>
+#include <vector>
 #include "runnable_item.h"
 #include "mpdpp.h"
 #include "settings.h"
 #include "menu.h"
+#include "utility/thread_pool.h"
+
+/// @return keys of elements in the range, computed in parallel.
+template <typename Iterator, typename KeyFunction>
+auto computeKeys(Iterator first, Iterator last, KeyFunction key)
+-> std::vector<typename std::decay<decltype(key(*first))>::type>
+{
+	const size_t part_size = 1024;
+	size_t size = last-first;
+	std::vector<typename std::decay<decltype(key(*first))>::type> keys(size);
+	ThreadPool::instance().run((size+part_size-1)/part_size, [&](size_t part) {
+		size_t end = std::min(size, (part+1)*part_size);
+		for (size_t i = part*part_size; i < end; ++i)
+			keys[i] = key(*(first+i));
+	});
+	return keys;
+}
+
+/// Sorts the range by given keys, i-th key belonging to i-th element.
+/// Elements with equal keys retain their relative order.
+template <typename Iterator, typename KeyT>
+void sortByKeys(Iterator first, Iterator last, std::vector<KeyT> keys)
+{
+	typedef typename std::iterator_traits<Iterator>::value_type ValueT;
+
+	size_t size = last-first;
+	assert(keys.size() == size);
+	std::vector<std::pair<KeyT, size_t>> indexed_keys;
+	indexed_keys.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+		indexed_keys.push_back(std::make_pair(std::move(keys[i]), i));
+	parallelSort(indexed_keys.begin(), indexed_keys.end(),
+		[](const std::pair<KeyT, size_t> &a, const std::pair<KeyT, size_t> &b) {
+			return a < b;
+	});
+
+	std::vector<ValueT> sorted;
+	sorted.reserve(size);
+	for (const auto &k : indexed_keys)
+		sorted.push_back(std::move(*(first+k.second)));
+	std::move(sorted.begin(), sorted.end(), first);
+}
+
+/// Sorts the range by keys computed once per element (in parallel), so
+/// that expensive comparisons don't need to be made O(n log n) times.
+/// Elements with equal keys retain their relative order.
+template <typename Iterator, typename KeyFunction>
+void sortByKey(Iterator first, Iterator last, KeyFunction key)
+{
+	sortByKeys(first, last, computeKeys(first, last, key));
+}
 
 class LocaleStringComparison
 {
@@ -44,6 +97,13 @@ public:
 	}
 
 	int compare(const char *a, size_t a_len, const char *b, size_t b_len) const;
+
+	/// @return collation key of the string, i.e. a string such that comparing
+	/// keys of two strings bytewise gives the same result as compare().
+	std::string key(const char *s, size_t len) const;
+	std::string key(const std::string &s) const {
+		return key(s.c_str(), s.length());
+	}
 };
 
 class LocaleBasedSorting
@@ -74,6 +134,28 @@ public:
 	bool operator()(const RunnableItem<ItemT, FunT> &a, const RunnableItem<ItemT, FunT> &b) const {
 		return m_cmp(a.item(), b.item()) < 0;
 	}
+
+	// keys consistent with the above comparisons
+	std::string key(const std::string &s) const { return m_cmp.key(s); }
+	std::string key(const MPD::Playlist &p) const { return m_cmp.key(p.path()); }
+	std::string key(const MPD::Song &s) const { return m_cmp.key(s.getName()); }
+
+	template <typename A, typename B>
+	std::string key(const std::pair<A, B> &p) const {
+		return key(p.first);
+	}
+
+	template <typename ItemT, typename FunT>
+	std::string key(const RunnableItem<ItemT, FunT> &item) const {
+		return key(item.item());
+	}
+
+	template <typename Iterator>
+	void sort(Iterator first, Iterator last) const {
+		sortByKey(first, last, [this](const typename std::iterator_traits<Iterator>::value_type &v) {
+			return key(v);
+		});
+	}
 };
 
 class LocaleBasedItemSorting
@@ -90,6 +172,19 @@ public:
 	bool operator()(const NC::Menu<MPD::Item>::Item &a, const NC::Menu<MPD::Item>::Item &b) const {
 		return (*this)(a.value(), b.value());
 	}
+
+	/// @return key consistent with the above comparison.
+	std::string key(const MPD::Item &item) const;
+	std::string key(const NC::Menu<MPD::Item>::Item &item) const {
+		return key(item.value());
+	}
+
+	template <typename Iterator>
+	void sort(Iterator first, Iterator last) const {
+		sortByKey(first, last, [this](const typename std::iterator_traits<Iterator>::value_type &v) {
+			return key(v);
+		});
+	}
 };
 
 #endif // NCMPCPP_UTILITY_COMPARATORS_H
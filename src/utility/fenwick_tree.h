@@ -0,0 +1,83 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_FENWICK_TREE_H
+#define NCMPCPP_UTILITY_FENWICK_TREE_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+/// Sequence of numbers that supports changing an element
+/// and computing sum of its prefix in logarithmic time.
+template <typename T>
+struct FenwickTree
+{
+	size_t size() const { return m_values.size(); }
+
+	T get(size_t i) const
+	{
+		assert(i < m_values.size());
+		return m_values[i];
+	}
+
+	/// Changes number of elements, new ones are zero.
+	void resize(size_t size)
+	{
+		// node of element i (counting from 1) holds the sum of elements
+		// (i - lowbit(i), i], which for appended zeros is a difference
+		// of prefix sums of elements that are already there.
+		size_t old_size = m_values.size();
+		m_values.resize(size, T());
+		m_tree.resize(size, T());
+		for (size_t i = old_size+1; i <= size; ++i)
+			m_tree[i-1] = prefixSum(i-1) - prefixSum(i - (i & -i));
+	}
+
+	void set(size_t i, T value)
+	{
+		assert(i < m_values.size());
+		T delta = value - m_values[i];
+		m_values[i] = value;
+		for (++i; i <= m_tree.size(); i += i & -i)
+			m_tree[i-1] += delta;
+	}
+
+	/// @return sum of the first n elements.
+	T prefixSum(size_t n) const
+	{
+		assert(n <= m_tree.size());
+		T result = T();
+		for (; n > 0; n -= n & -n)
+			result += m_tree[n-1];
+		return result;
+	}
+
+	T sum() const
+	{
+		return prefixSum(m_tree.size());
+	}
+
+private:
+	std::vector<T> m_values;
+	std::vector<T> m_tree;
+};
+
+#endif // NCMPCPP_UTILITY_FENWICK_TREE_H
@@ -0,0 +1,90 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_LRU_CACHE_H
+#define NCMPCPP_UTILITY_LRU_CACHE_H
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+/// Map with limited number of elements that removes
+/// the least recently used one if it runs out of space.
+template <typename KeyT, typename ValueT, typename HashT = std::hash<KeyT>>
+struct LRUCache
+{
+	LRUCache(size_t capacity)
+	: m_capacity(capacity), m_hits(0), m_misses(0)
+	{
+		assert(m_capacity > 0);
+	}
+
+	/// @return pointer to the value associated with the key (which becomes
+	/// the most recently used one) or nullptr if there is no such value.
+	ValueT *find(const KeyT &key)
+	{
+		auto it = m_index.find(key);
+		if (it == m_index.end())
+		{
+			++m_misses;
+			return nullptr;
+		}
+		++m_hits;
+		m_elements.splice(m_elements.begin(), m_elements, it->second);
+		return &it->second->second;
+	}
+
+	/// Associates the value with the key that isn't in the cache.
+	ValueT &insert(const KeyT &key, ValueT value)
+	{
+		assert(m_index.count(key) == 0);
+		if (m_elements.size() == m_capacity)
+		{
+			m_index.erase(m_elements.back().first);
+			m_elements.pop_back();
+		}
+		m_elements.emplace_front(key, std::move(value));
+		m_index.emplace(key, m_elements.begin());
+		return m_elements.front().second;
+	}
+
+	void clear()
+	{
+		m_index.clear();
+		m_elements.clear();
+	}
+
+	size_t hits() const { return m_hits; }
+	size_t misses() const { return m_misses; }
+
+private:
+	typedef std::list<std::pair<KeyT, ValueT>> Elements;
+
+	size_t m_capacity;
+	Elements m_elements;
+	std::unordered_map<KeyT, typename Elements::iterator, HashT> m_index;
+
+	size_t m_hits;
+	size_t m_misses;
+};
+
+#endif // NCMPCPP_UTILITY_LRU_CACHE_H
@@ -0,0 +1,236 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+
+#include "utility/permutation.h"
+
+namespace {
+
+struct Block
+{
+	Block(size_t start_, size_t length_)
+	: start(start_), length(length_)
+	{ }
+
+	size_t start;
+	size_t length;
+};
+
+size_t countSwaps(const std::vector<size_t> &permutation)
+{
+	// each cycle of length k requires k-1 swaps
+	std::vector<bool> visited(permutation.size());
+	size_t result = 0;
+	for (size_t i = 0; i < permutation.size(); ++i)
+	{
+		if (visited[i])
+			continue;
+		for (size_t j = i; !visited[j]; j = permutation[j])
+		{
+			visited[j] = true;
+			++result;
+		}
+		--result;
+	}
+	return result;
+}
+
+std::vector<PermutationStep> planSwaps(const std::vector<size_t> &permutation)
+{
+	std::vector<PermutationStep> result;
+	std::vector<size_t> items(permutation.size()), positions(permutation.size());
+	for (size_t i = 0; i < permutation.size(); ++i)
+		items[i] = positions[i] = i;
+	for (size_t i = 0; i < permutation.size(); ++i)
+	{
+		if (items[i] == permutation[i])
+			continue;
+		size_t j = positions[permutation[i]];
+		std::swap(items[i], items[j]);
+		positions[items[i]] = i;
+		positions[items[j]] = j;
+		result.push_back(PermutationStep::swap(i, j));
+	}
+	return result;
+}
+
+/// @return blocks of items that are adjacent both before
+/// and after the permutation, in the order of the latter.
+std::vector<Block> findBlocks(const std::vector<size_t> &permutation)
+{
+	std::vector<Block> result;
+	for (size_t i = 0; i < permutation.size(); ++i)
+	{
+		if (!result.empty() && result.back().start+result.back().length == permutation[i])
+			++result.back().length;
+		else
+			result.push_back(Block(permutation[i], 1));
+	}
+	return result;
+}
+
+/// @return flags marking blocks that form the heaviest
+/// subsequence sorted by their original positions.
+std::vector<bool> heaviestIncreasingSubsequence(const std::vector<size_t> &ranks,
+                                                const std::vector<size_t> &weights)
+{
+	// Fenwick tree for prefix maximum of (weight, index of the last block).
+	const size_t none = -1;
+	typedef std::pair<size_t, size_t> Entry;
+	std::vector<Entry> tree(ranks.size()+1, Entry(0, none));
+	std::vector<size_t> previous(ranks.size());
+	Entry best(0, none);
+	for (size_t i = 0; i < ranks.size(); ++i)
+	{
+		Entry prefix(0, none);
+		for (size_t r = ranks[i]; r > 0; r -= r & -r)
+			prefix = std::max(prefix, tree[r]);
+		previous[i] = prefix.second;
+		Entry current(prefix.first+weights[i], i);
+		for (size_t r = ranks[i]+1; r < tree.size(); r += r & -r)
+			tree[r] = std::max(tree[r], current);
+		best = std::max(best, current);
+	}
+	std::vector<bool> result(ranks.size());
+	for (size_t i = best.second; i != none; i = previous[i])
+		result[i] = true;
+	return result;
+}
+
+struct SumTree
+{
+	SumTree(size_t size)
+	: m_tree(size+1)
+	{ }
+
+	void add(size_t idx, ptrdiff_t value)
+	{
+		for (++idx; idx < m_tree.size(); idx += idx & -idx)
+			m_tree[idx] += value;
+	}
+
+	/// @return sum of values with indices lower than idx
+	ptrdiff_t prefix(size_t idx) const
+	{
+		ptrdiff_t result = 0;
+		for (; idx > 0; idx -= idx & -idx)
+			result += m_tree[idx];
+		return result;
+	}
+
+private:
+	std::vector<ptrdiff_t> m_tree;
+};
+
+void addMove(std::vector<PermutationStep> &steps, size_t start, size_t length, size_t to,
+             PermutationCommands commands)
+{
+	if (start == to)
+		return;
+	if (commands != PermutationCommands::SingleMoves || length == 1)
+		steps.push_back(PermutationStep::move(start, start+length, to));
+	else if (to < start)
+	{
+		for (size_t i = 0; i < length; ++i)
+			steps.push_back(PermutationStep::move(start+i, start+i+1, to+i));
+	}
+	else
+	{
+		for (size_t i = length; i > 0; --i)
+			steps.push_back(PermutationStep::move(start+i-1, start+i, to+i-1));
+	}
+}
+
+}
+
+std::vector<PermutationStep> planPermutation(const std::vector<size_t> &permutation,
+                                             PermutationCommands commands)
+{
+	auto blocks = findBlocks(permutation);
+
+	// positions of blocks in the original sequence
+	std::vector<size_t> by_rank(blocks.size()), ranks(blocks.size());
+	for (size_t i = 0; i < blocks.size(); ++i)
+		by_rank[i] = i;
+	std::sort(by_rank.begin(), by_rank.end(), [&blocks](size_t a, size_t b) {
+		return blocks[a].start < blocks[b].start;
+	});
+	for (size_t i = 0; i < by_rank.size(); ++i)
+		ranks[by_rank[i]] = i;
+
+	// If items are moved one by one, the cost of moving a block is its length,
+	// otherwise each block is moved with a single command.
+	std::vector<size_t> weights(blocks.size(), 1);
+	if (commands == PermutationCommands::SingleMoves)
+	{
+		for (size_t i = 0; i < blocks.size(); ++i)
+			weights[i] = blocks[i].length;
+	}
+	auto kept = heaviestIncreasingSubsequence(ranks, weights);
+
+	if (commands == PermutationCommands::SwapsAndRangeMoves)
+	{
+		size_t moves = std::count(kept.begin(), kept.end(), false);
+		if (countSwaps(permutation) < moves)
+			return planSwaps(permutation);
+	}
+
+	// Blocks that are not kept in place are put right after their predecessor
+	// (in the target order), so the final order of slots is known in advance:
+	// moved blocks preceding the first kept one, then all blocks in their
+	// original order, each kept one followed by the moved blocks that succeed
+	// it. Current position of a block is then the total length of blocks
+	// occupying preceding slots.
+	const size_t none = -1;
+	std::vector<size_t> source_slot(blocks.size()), target_slot(blocks.size(), none);
+	size_t slot = 0;
+	for (size_t i = 0; i < blocks.size() && !kept[i]; ++i)
+		target_slot[i] = slot++;
+	for (auto b : by_rank)
+	{
+		source_slot[b] = slot++;
+		if (kept[b])
+		{
+			for (size_t i = b+1; i < blocks.size() && !kept[i]; ++i)
+				target_slot[i] = slot++;
+		}
+	}
+
+	SumTree lengths(slot);
+	for (size_t i = 0; i < blocks.size(); ++i)
+		lengths.add(source_slot[i], blocks[i].length);
+
+	std::vector<PermutationStep> result;
+	for (size_t i = 0; i < blocks.size(); ++i)
+	{
+		if (kept[i])
+			continue;
+		assert(target_slot[i] != none);
+		ptrdiff_t length = blocks[i].length;
+		size_t start = lengths.prefix(source_slot[i]);
+		lengths.add(source_slot[i], -length);
+		size_t to = lengths.prefix(target_slot[i]);
+		lengths.add(target_slot[i], length);
+		addMove(result, start, length, to, commands);
+	}
+	return result;
+}
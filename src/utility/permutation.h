@@ -0,0 +1,77 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_PERMUTATION_H
+#define NCMPCPP_UTILITY_PERMUTATION_H
+
+#include <cstddef>
+#include <vector>
+
+struct PermutationStep
+{
+	enum class Type { Swap, Move };
+
+	static PermutationStep swap(size_t a, size_t b)
+	{
+		return PermutationStep(Type::Swap, a, b, 1);
+	}
+	static PermutationStep move(size_t start, size_t end, size_t to)
+	{
+		return PermutationStep(Type::Move, start, to, end-start);
+	}
+
+	Type type() const { return m_type; }
+
+	// swap: positions of swapped items
+	size_t first() const { return m_first; }
+	size_t second() const { return m_second; }
+
+	// move: range [start, end) is moved so that it begins at
+	// position to (as in MPD's move command), i.e. the index
+	// is relative to the sequence with the range removed.
+	size_t start() const { return m_first; }
+	size_t end() const { return m_first+m_length; }
+	size_t to() const { return m_second; }
+
+private:
+	PermutationStep(Type type_, size_t first_, size_t second_, size_t length_)
+	: m_type(type_), m_first(first_), m_second(second_), m_length(length_)
+	{ }
+
+	Type m_type;
+	size_t m_first;
+	size_t m_second;
+	size_t m_length;
+};
+
+enum class PermutationCommands { SwapsAndRangeMoves, RangeMoves, SingleMoves };
+
+/// Computes a sequence of steps that turns 0, 1, ..., n-1 into given
+/// permutation, where permutation[i] is the original index of the item
+/// that should end up at position i. Depending on available commands,
+/// it either uses swaps (n minus number of cycles of the permutation)
+/// or range moves of all items outside the longest increasing sequence
+/// of blocks, whichever requires less commands to be sent.
+/// @param commands commands that can be used. Moves of ranges longer
+///  than one item are not generated if SingleMoves is given.
+std::vector<PermutationStep> planPermutation(const std::vector<size_t> &permutation,
+                                             PermutationCommands commands);
+
+#endif // NCMPCPP_UTILITY_PERMUTATION_H
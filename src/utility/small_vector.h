@@ -0,0 +1,195 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_SMALL_VECTOR_H
+#define NCMPCPP_UTILITY_SMALL_VECTOR_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+/// Vector that keeps up to N elements inside itself
+/// and allocates memory only if it grows beyond that.
+template <typename T, size_t N>
+struct SmallVector
+{
+	typedef T value_type;
+	typedef T *iterator;
+	typedef const T *const_iterator;
+
+	SmallVector()
+	: m_data(inlineData()), m_size(0), m_capacity(N) { }
+
+	SmallVector(const SmallVector &rhs)
+	: m_data(inlineData()), m_size(0), m_capacity(N)
+	{
+		reserve(rhs.m_size);
+		std::uninitialized_copy(rhs.begin(), rhs.end(), m_data);
+		m_size = rhs.m_size;
+	}
+
+	SmallVector(SmallVector &&rhs)
+	: m_data(inlineData()), m_size(0), m_capacity(N)
+	{
+		steal(rhs);
+	}
+
+	SmallVector &operator=(const SmallVector &rhs)
+	{
+		if (this != &rhs)
+		{
+			SmallVector tmp(rhs);
+			clear();
+			deallocate();
+			steal(tmp);
+		}
+		return *this;
+	}
+
+	SmallVector &operator=(SmallVector &&rhs)
+	{
+		if (this != &rhs)
+		{
+			clear();
+			deallocate();
+			steal(rhs);
+		}
+		return *this;
+	}
+
+	~SmallVector()
+	{
+		clear();
+		deallocate();
+	}
+
+	iterator begin() { return m_data; }
+	iterator end() { return m_data + m_size; }
+	const_iterator begin() const { return m_data; }
+	const_iterator end() const { return m_data + m_size; }
+
+	size_t size() const { return m_size; }
+	size_t capacity() const { return m_capacity; }
+	bool empty() const { return m_size == 0; }
+
+	T &operator[](size_t i) { assert(i < m_size); return m_data[i]; }
+	const T &operator[](size_t i) const { assert(i < m_size); return m_data[i]; }
+
+	T &back() { assert(m_size > 0); return m_data[m_size-1]; }
+	const T &back() const { assert(m_size > 0); return m_data[m_size-1]; }
+
+	void reserve(size_t capacity)
+	{
+		if (capacity <= m_capacity)
+			return;
+		T *data = static_cast<T *>(::operator new(capacity * sizeof(T)));
+		for (size_t i = 0; i < m_size; ++i)
+		{
+			new (data + i) T(std::move(m_data[i]));
+			m_data[i].~T();
+		}
+		deallocate();
+		m_data = data;
+		m_capacity = capacity;
+	}
+
+	template <typename... Args>
+	void emplace_back(Args&&... args)
+	{
+		if (m_size == m_capacity)
+			reserve(2 * m_capacity);
+		new (m_data + m_size) T(std::forward<Args>(args)...);
+		++m_size;
+	}
+
+	/// Inserts value before position and returns iterator to it.
+	iterator insert(const_iterator position, T value)
+	{
+		size_t i = position - begin();
+		assert(i <= m_size);
+		emplace_back(std::move(value));
+		std::rotate(begin() + i, end() - 1, end());
+		return begin() + i;
+	}
+
+	iterator erase(iterator first, iterator last)
+	{
+		iterator new_end = std::move(last, end(), first);
+		for (iterator it = new_end; it != end(); ++it)
+			it->~T();
+		m_size = new_end - begin();
+		return first;
+	}
+
+	void clear()
+	{
+		erase(begin(), end());
+	}
+
+private:
+	T *inlineData()
+	{
+		return reinterpret_cast<T *>(&m_inline);
+	}
+
+	void deallocate()
+	{
+		if (m_data != inlineData())
+		{
+			::operator delete(m_data);
+			m_data = inlineData();
+			m_capacity = N;
+		}
+	}
+
+	/// Takes over elements of empty rhs, moving them
+	/// one by one if they are stored inside of it.
+	void steal(SmallVector &rhs)
+	{
+		assert(m_size == 0 && m_data == inlineData());
+		if (rhs.m_data == rhs.inlineData())
+		{
+			for (size_t i = 0; i < rhs.m_size; ++i)
+				new (m_data + i) T(std::move(rhs.m_data[i]));
+			m_size = rhs.m_size;
+			rhs.clear();
+		}
+		else
+		{
+			m_data = rhs.m_data;
+			m_size = rhs.m_size;
+			m_capacity = rhs.m_capacity;
+			rhs.m_data = rhs.inlineData();
+			rhs.m_size = 0;
+			rhs.m_capacity = N;
+		}
+	}
+
+	typename std::aligned_storage<N * sizeof(T), alignof(T)>::type m_inline;
+	T *m_data;
+	size_t m_size;
+	size_t m_capacity;
+};
+
+#endif // NCMPCPP_UTILITY_SMALL_VECTOR_H
@@ -0,0 +1,113 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include "utility/thread_pool.h"
+
+ThreadPool::ThreadPool(size_t threads)
+: m_job(nullptr), m_job_size(0), m_next_part(0)
+, m_generation(0), m_finished_workers(0), m_quit(false)
+{
+	for (size_t i = 1; i < threads; ++i)
+		m_threads.push_back(boost::thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		boost::lock_guard<boost::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_job_available.notify_all();
+	for (auto &t : m_threads)
+		t.join();
+}
+
+ThreadPool &ThreadPool::instance()
+{
+	static ThreadPool pool(std::max(1u, boost::thread::hardware_concurrency()));
+	return pool;
+}
+
+void ThreadPool::run(size_t n, const Job &job)
+{
+	if (m_threads.empty() || n <= 1)
+	{
+		for (size_t i = 0; i < n; ++i)
+			job(i);
+		return;
+	}
+	{
+		boost::lock_guard<boost::mutex> lock(m_mutex);
+		m_job = &job;
+		m_job_size = n;
+		m_next_part = 0;
+		m_exception = nullptr;
+		m_finished_workers = 0;
+		++m_generation;
+	}
+	m_job_available.notify_all();
+	execute();
+	// wait for all workers, so that none of them
+	// accesses the job after it's gone.
+	boost::unique_lock<boost::mutex> lock(m_mutex);
+	m_job_done.wait(lock, [this] { return m_finished_workers == m_threads.size(); });
+	m_job = nullptr;
+	if (m_exception)
+		std::rethrow_exception(m_exception);
+}
+
+void ThreadPool::work()
+{
+	size_t generation = 0;
+	boost::unique_lock<boost::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_job_available.wait(lock, [this, &generation] {
+			return m_quit || m_generation != generation;
+		});
+		if (m_quit)
+			break;
+		generation = m_generation;
+		lock.unlock();
+		execute();
+		lock.lock();
+		++m_finished_workers;
+		m_job_done.notify_all();
+	}
+}
+
+void ThreadPool::execute()
+{
+	for (size_t part; (part = m_next_part++) < m_job_size;)
+	{
+		try
+		{
+			(*m_job)(part);
+		}
+		catch (...)
+		{
+			boost::lock_guard<boost::mutex> lock(m_mutex);
+			if (!m_exception)
+				m_exception = std::current_exception();
+			// skip remaining parts
+			m_next_part = m_job_size;
+		}
+	}
+}
@@ -0,0 +1,141 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_THREAD_POOL_H
+#define NCMPCPP_UTILITY_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <exception>
+#include <functional>
+#include <vector>
+
+/// Fixed set of worker threads executing parts of a job together
+/// with the thread that submitted it.
+struct ThreadPool
+{
+	typedef std::function<void(size_t)> Job;
+
+	/// @param threads number of threads including the calling one.
+	ThreadPool(size_t threads);
+	~ThreadPool();
+
+	/// @return pool with one thread per available core.
+	static ThreadPool &instance();
+
+	size_t size() const { return m_threads.size()+1; }
+
+	/// Calls job(i) for each i in [0, n), possibly in parallel. Parts are
+	/// started in increasing order of i. Returns when all of them are done.
+	/// If any of them throws, the exception is rethrown.
+	void run(size_t n, const Job &job);
+
+private:
+	void work();
+	void execute();
+
+	std::vector<boost::thread> m_threads;
+
+	boost::mutex m_mutex;
+	boost::condition_variable m_job_available;
+	boost::condition_variable m_job_done;
+
+	const Job *m_job;
+	size_t m_job_size;
+	std::atomic<size_t> m_next_part;
+	std::exception_ptr m_exception;
+	size_t m_generation;
+	size_t m_finished_workers;
+	bool m_quit;
+};
+
+/// @return position of the first element in [first, last) that satisfies
+/// the predicate or last if there is none. Large ranges are scanned with
+/// thread pool, each part with its own copy of the predicate. Parts after
+/// the first match that was found are skipped.
+template <typename Iterator, typename PredicateT>
+Iterator parallelFindIf(Iterator first, Iterator last, const PredicateT &pred)
+{
+	const size_t min_part_size = 1024;
+	size_t size = last-first;
+	auto &pool = ThreadPool::instance();
+	if (pool.size() == 1 || size < 2*min_part_size)
+		return std::find_if(first, last, pred);
+
+	// use parts smaller than size/threads so that the first
+	// match is found soon if it's close to the beginning.
+	size_t part_size = std::max(min_part_size, size/(pool.size()*4));
+	size_t parts = (size+part_size-1)/part_size;
+	std::atomic<size_t> found(size);
+	pool.run(parts, [&](size_t part) {
+		PredicateT part_pred(pred);
+		size_t end = std::min(size, (part+1)*part_size);
+		for (size_t i = part*part_size; i < end && i < found.load(); ++i)
+		{
+			if (part_pred(*(first+i)))
+			{
+				size_t current = found.load();
+				while (i < current && !found.compare_exchange_weak(current, i)) { }
+				break;
+			}
+		}
+	});
+	return first+found.load();
+}
+
+/// Sorts the range (which needs to be random access) by sorting its parts in
+/// parallel with std::sort and merging them afterwards. Small ranges are
+/// sorted with std::sort directly.
+template <typename Iterator, typename CompareT>
+void parallelSort(Iterator first, Iterator last, CompareT cmp)
+{
+	const size_t min_part_size = 8192;
+	size_t size = last-first;
+	auto &pool = ThreadPool::instance();
+	size_t parts = std::min(pool.size(), size/min_part_size);
+	if (parts < 2)
+	{
+		std::sort(first, last, cmp);
+		return;
+	}
+
+	std::vector<size_t> bounds(parts+1);
+	for (size_t i = 0; i <= parts; ++i)
+		bounds[i] = size*i/parts;
+	pool.run(parts, [&](size_t part) {
+		std::sort(first+bounds[part], first+bounds[part+1], cmp);
+	});
+	// merge neighbouring sorted sequences until there is only one left
+	for (size_t width = 1; width < parts; width *= 2)
+	{
+		pool.run((parts+2*width-1)/(2*width), [&](size_t merge) {
+			size_t begin = merge*2*width;
+			size_t middle = std::min(begin+width, parts);
+			size_t end = std::min(begin+2*width, parts);
+			if (middle < end)
+				std::inplace_merge(first+bounds[begin], first+bounds[middle], first+bounds[end], cmp);
+		});
+	}
+}
+
+#endif // NCMPCPP_UTILITY_THREAD_POOL_H
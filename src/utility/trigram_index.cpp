@@ -0,0 +1,370 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+
+#include "utility/trigram_index.h"
+
+namespace {
+
+typedef std::string::const_iterator Iterator;
+
+char lowercase(char c)
+{
+	return c >= 'A' && c <= 'Z' ? c + ('a'-'A') : c;
+}
+
+uint32_t trigram(const char *s)
+{
+	return uint32_t(static_cast<unsigned char>(lowercase(s[0]))) << 16
+	     | uint32_t(static_cast<unsigned char>(lowercase(s[1]))) << 8
+	     | uint32_t(static_cast<unsigned char>(lowercase(s[2])));
+}
+
+enum class Repetition { Once, Optional, AtLeastOnce, Invalid };
+
+/// @return repetition of interval {m,n} (or {m}) with given contents.
+Repetition interval(Iterator begin, Iterator end)
+{
+	if (begin == end || !isdigit(*begin))
+		return Repetition::Invalid;
+	return std::all_of(begin, std::find(begin, end, ','),
+		[](char c) { return c == '0'; }
+	) ? Repetition::Optional : Repetition::AtLeastOnce;
+}
+
+Repetition quantifier(Iterator &pos, Iterator end, RegexSyntax syntax)
+{
+	Repetition result;
+	if (pos == end)
+		return Repetition::Once;
+	if (syntax == RegexSyntax::Basic)
+	{
+		// only * and \{m,n\} are special, + ? and { are ordinary characters.
+		if (*pos == '*')
+		{
+			++pos;
+			return Repetition::Optional;
+		}
+		if (*pos == '\\' && pos+1 != end && *(pos+1) == '{')
+		{
+			const char close_brace[] = "\\}";
+			auto close = std::search(pos+2, end, close_brace, close_brace+2);
+			if (close == end)
+				return Repetition::Invalid;
+			result = interval(pos+2, close);
+			pos = close+2;
+			return result;
+		}
+		return Repetition::Once;
+	}
+	switch (*pos)
+	{
+		case '*':
+		case '?':
+			result = Repetition::Optional;
+			++pos;
+			break;
+		case '+':
+			result = Repetition::AtLeastOnce;
+			++pos;
+			break;
+		case '{':
+		{
+			auto close = std::find(pos, end, '}');
+			if (close == end)
+				return Repetition::Invalid;
+			result = interval(pos+1, close);
+			if (result == Repetition::Invalid)
+				return result;
+			pos = close+1;
+			break;
+		}
+		default:
+			return Repetition::Once;
+	}
+	// lazy or possessive quantifier
+	if (pos != end && (*pos == '?' || *pos == '+'))
+		++pos;
+	return result;
+}
+
+bool skipCharacterClass(Iterator &pos, Iterator end, RegexSyntax syntax)
+{
+	++pos;
+	if (pos != end && *pos == '^')
+		++pos;
+	if (pos != end && *pos == ']')
+		++pos;
+	while (pos != end && *pos != ']')
+	{
+		if (*pos == '[' && pos+1 != end && *(pos+1) == ':')
+		{
+			auto close = std::search(pos+2, end, ":]", ":]"+2);
+			if (close == end)
+				return false;
+			pos = close+2;
+		}
+		// backslash is an ordinary character in lists of basic expressions
+		else if (syntax != RegexSyntax::Basic && *pos == '\\' && pos+1 != end)
+			pos += 2;
+		else
+			++pos;
+	}
+	if (pos == end)
+		return false;
+	++pos;
+	return true;
+}
+
+/// Parses a sequence of atoms up to the end of the expression or (if
+/// nested) closing parenthesis. Alternatives, lookarounds, inline flags,
+/// escape sequences other than escaped punctuation etc. are not supported
+/// and cause the whole expression to be skipped.
+bool parseSequence(Iterator &pos, Iterator end, RegexSyntax syntax, bool icase,
+                   bool nested, std::vector<std::string> &literals)
+{
+	std::string run;
+	auto flush = [&run, &literals] {
+		if (run.length() >= 3)
+			literals.push_back(run);
+		run.clear();
+	};
+	// appends character [char_start, char_end) followed by a quantifier at pos
+	auto character = [&](Iterator char_start, Iterator char_end) {
+		bool is_ascii = static_cast<unsigned char>(*char_start) < 0x80;
+		auto repetition = quantifier(pos, end, syntax);
+		if (repetition == Repetition::Invalid)
+			return false;
+		// letters outside of ASCII may match case
+		// insensitively in a number of ways.
+		if (repetition == Repetition::Optional || (icase && !is_ascii))
+		{
+			flush();
+			return true;
+		}
+		std::transform(char_start, char_end, std::back_inserter(run), lowercase);
+		if (repetition == Repetition::AtLeastOnce)
+			flush();
+		return true;
+	};
+	// parses group with pos right after its opening parenthesis
+	auto group = [&] {
+		std::vector<std::string> group_literals;
+		if (!parseSequence(pos, end, syntax, icase, true, group_literals) || pos == end)
+			return false;
+		// skip closing parenthesis
+		pos += syntax == RegexSyntax::Basic ? 2 : 1;
+		flush();
+		auto repetition = quantifier(pos, end, syntax);
+		if (repetition == Repetition::Invalid)
+			return false;
+		if (repetition != Repetition::Optional)
+			literals.insert(literals.end(), group_literals.begin(), group_literals.end());
+		return true;
+	};
+	// zero width assertion, literals before and after it are separate
+	auto assertion = [&] {
+		flush();
+		return quantifier(pos, end, syntax) != Repetition::Invalid;
+	};
+	while (pos != end)
+	{
+		if (syntax == RegexSyntax::Literal)
+		{
+			auto char_start = pos;
+			++pos;
+			while (pos != end && (*pos & 0xC0) == 0x80)
+				++pos;
+			if (icase && static_cast<unsigned char>(*char_start) >= 0x80)
+				flush();
+			else
+				std::transform(char_start, pos, std::back_inserter(run), lowercase);
+			continue;
+		}
+		bool is_basic = syntax == RegexSyntax::Basic;
+		switch (*pos)
+		{
+			case '|':
+			case '(':
+			case ')':
+			case '+':
+			case '?':
+			case '{':
+				if (is_basic)
+				{
+					++pos;
+					if (!character(pos-1, pos))
+						return false;
+					break;
+				}
+				if (*pos == ')')
+				{
+					flush();
+					return nested;
+				}
+				if (*pos == '(')
+				{
+					++pos;
+					if (pos != end && *pos == '?')
+						return false;
+					if (!group())
+						return false;
+					break;
+				}
+				return false;
+			case '[':
+				if (!skipCharacterClass(pos, end, syntax))
+					return false;
+				flush();
+				if (quantifier(pos, end, syntax) == Repetition::Invalid)
+					return false;
+				break;
+			case '\\':
+			{
+				++pos;
+				if (pos == end)
+					return false;
+				char c = *pos++;
+				if (is_basic && c == '(')
+				{
+					if (!group())
+						return false;
+				}
+				else if (is_basic && c == ')')
+				{
+					// leave the closing parenthesis for the caller
+					pos -= 2;
+					flush();
+					return nested;
+				}
+				// operators of basic expressions in some dialects
+				else if (is_basic && (c == '{' || c == '}' || c == '|' || c == '+' || c == '?'))
+					return false;
+				else if (c == '<' || c == '>' || c == '`' || c == '\'')
+				{
+					if (!assertion())
+						return false;
+				}
+				else if (static_cast<unsigned char>(c) < 0x80 && ispunct(c))
+				{
+					if (!character(pos-1, pos))
+						return false;
+				}
+				// letters and digits start character classes,
+				// assertions, back references, numeric codes etc.
+				else
+					return false;
+				break;
+			}
+			case '.':
+				++pos;
+				flush();
+				if (quantifier(pos, end, syntax) == Repetition::Invalid)
+					return false;
+				break;
+			case '^':
+			case '$':
+				++pos;
+				if (!assertion())
+					return false;
+				break;
+			case '*':
+				return false;
+			default:
+			{
+				auto char_start = pos;
+				++pos;
+				while (pos != end && (*pos & 0xC0) == 0x80)
+					++pos;
+				if (!character(char_start, pos))
+					return false;
+			}
+		}
+	}
+	flush();
+	return !nested;
+}
+
+}
+
+std::vector<std::string> requiredLiterals(const std::string &regex, RegexSyntax syntax, bool icase)
+{
+	std::vector<std::string> result;
+	auto pos = regex.begin();
+	if (!parseSequence(pos, regex.end(), syntax, icase, false, result) || pos != regex.end())
+		result.clear();
+	return result;
+}
+
+void TrigramIndex::clear()
+{
+	m_postings.clear();
+	m_size = 0;
+}
+
+void TrigramIndex::add(const std::string &s)
+{
+	size_t id = m_size++;
+	for (size_t i = 0; i+3 <= s.length(); ++i)
+	{
+		auto &postings = m_postings[trigram(&s[i])];
+		if (postings.empty() || postings.back() != id)
+			postings.push_back(id);
+	}
+}
+
+std::vector<size_t> TrigramIndex::candidates(const std::vector<std::string> &literals) const
+{
+	std::vector<const std::vector<size_t> *> lists;
+	for (const auto &literal : literals)
+	{
+		for (size_t i = 0; i+3 <= literal.length(); ++i)
+		{
+			auto it = m_postings.find(trigram(&literal[i]));
+			if (it == m_postings.end())
+				return std::vector<size_t>();
+			lists.push_back(&it->second);
+		}
+	}
+	if (lists.empty())
+	{
+		std::vector<size_t> result(m_size);
+		for (size_t i = 0; i < m_size; ++i)
+			result[i] = i;
+		return result;
+	}
+	// start with the shortest list to keep intermediate results small
+	std::sort(lists.begin(), lists.end(),
+		[](const std::vector<size_t> *a, const std::vector<size_t> *b) {
+			return a->size() < b->size() || (a->size() == b->size() && a < b);
+	});
+	lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+	std::vector<size_t> result = *lists.front(), common;
+	for (auto list = lists.begin()+1; list != lists.end() && !result.empty(); ++list)
+	{
+		common.clear();
+		std::set_intersection(result.begin(), result.end(),
+			(*list)->begin(), (*list)->end(), std::back_inserter(common));
+		result.swap(common);
+	}
+	return result;
+}
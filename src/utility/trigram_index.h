@@ -0,0 +1,59 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2014 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_TRIGRAM_INDEX_H
+#define NCMPCPP_UTILITY_TRIGRAM_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Syntax of regular expressions that literals are extracted from.
+/// Extended covers both POSIX extended and Perl expressions.
+enum class RegexSyntax { Literal, Basic, Extended };
+
+/// @return literal strings (lowercased if matching is case insensitive)
+/// that each string matching given regular expression has to contain.
+/// Only literals that are at least three bytes long are returned, so if
+/// the result is empty, nothing can be assumed about matching strings.
+std::vector<std::string> requiredLiterals(const std::string &regex, RegexSyntax syntax, bool icase);
+
+/// Index of trigrams of a sequence of strings, used for finding strings
+/// that might contain given literals. Matching is ASCII case insensitive.
+struct TrigramIndex
+{
+	void clear();
+
+	/// Appends string with the next consecutive id to the index.
+	void add(const std::string &s);
+
+	size_t size() const { return m_size; }
+
+	/// @return sorted ids of strings containing all trigrams of literals
+	/// (which all need to be at least three bytes long).
+	std::vector<size_t> candidates(const std::vector<std::string> &literals) const;
+
+private:
+	std::unordered_map<uint32_t, std::vector<size_t>> m_postings;
+	size_t m_size = 0;
+};
+
+#endif // NCMPCPP_UTILITY_TRIGRAM_INDEX_H
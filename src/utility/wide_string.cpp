@@ -18,15 +18,80 @@
  *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
  ***************************************************************************/
 
+#include <array>
 #include <cassert>
+#include <cstdint>
 #include "utility/wide_string.h"
 
+namespace {
+
+/// Widths of all characters from the Basic Multilingual Plane, as returned by
+/// wcwidth, stored on two bits each (shifted by one, so that -1 fits).
+class WidthTable
+{
+public:
+	WidthTable()
+	{
+		m_widths.fill(0);
+		for (size_t wc = 0; wc < Size; ++wc)
+		{
+			unsigned width = std::min(wcwidth(wc) + 1, 3);
+			m_widths[wc / 4] |= width << (wc % 4 * 2);
+		}
+	}
+
+	int operator()(wchar_t wc) const
+	{
+		if (static_cast<uint32_t>(wc) >= Size)
+			return wcwidth(wc);
+		return ((m_widths[wc / 4] >> (wc % 4 * 2)) & 3) - 1;
+	}
+
+private:
+	static const size_t Size = 0x10000;
+	std::array<uint8_t, Size / 4> m_widths;
+};
+
+/// @return width of the character, equivalent to wcwidth.
+/// @note the table is built on the first call, so locale
+/// needs to be already set at this point.
+int charWidth(wchar_t wc)
+{
+	static const WidthTable table;
+	return table(wc);
+}
+
+/// @return true if all characters are printable ASCII, i.e. each of them
+/// occupies exactly one column. There are no early exits, so that the loop
+/// can be vectorized by the compiler.
+bool isPrintableASCII(const wchar_t *ws, size_t length)
+{
+	const size_t chunk = 16;
+	size_t i = 0;
+	for (; i + chunk <= length; i += chunk)
+	{
+		uint32_t invalid = 0;
+		for (size_t j = 0; j < chunk; ++j)
+			invalid |= static_cast<uint32_t>(ws[i+j]) - 0x20 >= 0x5f;
+		if (invalid)
+			return false;
+	}
+	uint32_t invalid = 0;
+	for (; i < length; ++i)
+		invalid |= static_cast<uint32_t>(ws[i]) - 0x20 >= 0x5f;
+	return !invalid;
+}
+
+}
+
 size_t wideLength(const std::wstring &ws)
 {
+	if (isPrintableASCII(ws.data(), ws.length()))
+		return ws.length();
 	size_t result = 0;
 	for (const auto &wc : ws)
 	{
-		int len = wcwidth(wc);
+		int len = charWidth(wc);
 		if (len < 0)
 			++result;
 		else
@@ -37,11 +102,17 @@ size_t wideLength(const std::wstring &ws)
 
 void wideCut(std::wstring &ws, size_t max_length)
 {
+	if (isPrintableASCII(ws.data(), std::min(ws.length(), max_length+1)))
+	{
+		if (ws.length() > max_length)
+			ws.resize(max_length);
+		return;
+	}
 	size_t i = 0;
 	int remained_len = max_length;
 	for (; i < ws.length(); ++i)
 	{
-		remained_len -= std::max(wcwidth(ws[i]), 1);
+		remained_len -= std::max(charWidth(ws[i]), 1);
 		if (remained_len < 0)
 		{
 			ws.resize(i);
@@ -56,11 +127,20 @@ std::wstring wideShorten(const std::wstring &ws, size_t max_length)
 	if (wideLength(ws) > max_length)
 	{
 		const size_t half_max = max_length/2 - 1;
+		if (max_length >= 2 && isPrintableASCII(ws.data(), ws.length()))
+		{
+			// string is longer than max_length, so both halves fit
+			result.reserve(2*half_max + 2);
+			result.append(ws, 0, half_max);
+			result += L"..";
+			result.append(ws, ws.length() - half_max, half_max);
+			return result;
+		}
 		size_t len = 0;
 		// get beginning of string
 		for (auto it = ws.begin(); it != ws.end(); ++it)
 		{
-			len += wcwidth(*it);
+			len += charWidth(*it);
 			if (len > half_max)
 				break;
 			result += *it;
@@ -70,7 +150,7 @@ std::wstring wideShorten(const std::wstring &ws, size_t max_length)
 		// get end of string in reverse order
 		for (auto it = ws.rbegin(); it != ws.rend(); ++it)
 		{
-			len += wcwidth(*it);
+			len += charWidth(*it);
 			if (len > half_max)
 				break;
 			end += *it;
@@ -83,4 +163,3 @@ std::wstring wideShorten(const std::wstring &ws, size_t max_length)
 		result = ws;
 	return result;
 }
-